@@ -0,0 +1,282 @@
+#ifndef AI_POOL_HPP
+#define AI_POOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include "game.hpp"
+#include "engine.hpp"
+#include "book.hpp"
+
+// 電腦對手的思考工作池
+//
+// 每個 worker 一條執行緒、一個 Engine（各自的置換表，共用開局庫）與一個工作佇列。
+// 送進來的工作輪流放到各 worker 的佇列；自己的佇列空了就從別人佇列的尾端偷，
+// 所以一局想很久時排在它後面的工作不會卡住。worker 數就是同時思考的上限，
+// 再多的電腦對局也只會讓佇列變長，不會多吃 CPU，網路 reactor 不受影響。
+// 完成時在 worker 執行緒上呼叫 done，由呼叫端自己把結果送回對局所在的 reactor。
+//
+// 對手思考時可以請 worker 先替對手想（ponder，見 Engine::ponder）：worker 沒有工作、
+// 也偷不到工作時才搜，搜到的節點留在那個 worker 的置換表，
+// 所以同一局的下一步要指定送回同一個 worker（submit 的 worker 參數）。
+// 有真正的工作送到這個 worker，或對手已經下了（stop_ponder），就立刻停下。
+class AiPool {
+public:
+    struct Job {
+        Game game;
+        char player;
+        int budget_ms;          // 這一步最多想多久（單執行緒搜尋，等於 CPU 時間）
+        int max_depth;
+        std::function<void(const SearchResult&, int worker)> done;
+        Engine::Clock::time_point queued_at;
+    };
+
+    static const int PONDER_MAX_MS = 60000;     // 對手一直不下時最多替它想多久
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Job*> jobs;
+        std::thread thread;
+        Engine* engine;
+        std::atomic<bool> stop;             // engine 的停止旗標，只在 ponder 時會被設定
+        std::atomic<bool> has_ponder;       // 有等著開始的 ponder
+        Game ponder_game;                   // 以下由 mutex 保護
+        char ponder_player;
+        uint64_t ponder_token;
+        uint64_t pondering;                 // 正在 ponder 的 token，0 代表沒有
+
+        Worker() : engine(NULL), stop(false), has_ponder(false), ponder_player('X'), ponder_token(0), pondering(0) {}
+    };
+
+    std::vector<Worker*> workers;
+    std::mutex idle_mutex;
+    std::condition_variable idle;
+    bool stopping;
+    std::atomic<unsigned> next_worker;
+    std::atomic<uint64_t> queued;
+    std::atomic<uint64_t> running;
+    std::atomic<uint64_t> completed;
+    std::atomic<uint64_t> stolen;
+    std::atomic<uint64_t> cpu_us;           // 所有工作實際用掉的 CPU 時間
+    std::atomic<uint64_t> wait_us;          // 所有工作在佇列裡等的時間
+    std::atomic<uint64_t> ponders;
+    std::atomic<uint64_t> ponder_us;        // 花在 ponder 的 CPU 時間
+
+    AiPool(const AiPool&);
+    AiPool& operator=(const AiPool&);
+
+    static uint64_t thread_cpu_us() {
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    // 先拿自己佇列的最前面，沒有就偷別人的最後面
+    Job* take(size_t self) {
+        {
+            Worker* w = workers[self];
+            std::lock_guard<std::mutex> lock(w->mutex);
+            if (!w->jobs.empty()) {
+                Job* job = w->jobs.front();
+                w->jobs.pop_front();
+                queued--;
+                return job;
+            }
+        }
+        for (size_t i = 1; i < workers.size(); i++) {
+            Worker* w = workers[(self + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(w->mutex);
+            if (!w->jobs.empty()) {
+                Job* job = w->jobs.back();
+                w->jobs.pop_back();
+                queued--;
+                stolen++;
+                return job;
+            }
+        }
+        return NULL;
+    }
+
+    // 沒有工作可做時才呼叫；有 ponder 就搜到被停下為止
+    bool ponder_once(size_t self) {
+        Worker* w = workers[self];
+        Game game;
+        char player;
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+            if (stopping) return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(w->mutex);
+            if (!w->has_ponder.load()) return false;
+            game = w->ponder_game;
+            player = w->ponder_player;
+            w->pondering = w->ponder_token;
+            w->has_ponder = false;
+        }
+        ponders++;
+        uint64_t cpu_start = thread_cpu_us();
+        w->engine->clear();
+        w->engine->ponder(game, player, &w->stop, Engine::Clock::now() + std::chrono::milliseconds(PONDER_MAX_MS));
+        ponder_us += thread_cpu_us() - cpu_start;
+        {
+            std::lock_guard<std::mutex> lock(w->mutex);
+            w->pondering = 0;
+            w->stop = false;
+        }
+        return true;
+    }
+
+    void run(size_t self) {
+        Worker* w = workers[self];
+        Engine* engine = w->engine;
+        while (true) {
+            Job* job = take(self);
+            if (!job) {
+                if (ponder_once(self)) continue;
+                std::unique_lock<std::mutex> lock(idle_mutex);
+                while (!stopping && queued.load() == 0 && !w->has_ponder.load()) idle.wait(lock);
+                if (stopping) return;
+                continue;
+            }
+            running++;
+            Engine::Clock::time_point start = Engine::Clock::now();
+            wait_us += std::chrono::duration_cast<std::chrono::microseconds>(start - job->queued_at).count();
+
+            uint64_t cpu_start = thread_cpu_us();
+            engine->clear();
+            SearchResult result = engine->search(job->game, job->player,
+                                                 start + std::chrono::milliseconds(job->budget_ms), job->max_depth);
+            cpu_us += thread_cpu_us() - cpu_start;
+
+            running--;
+            completed++;
+            job->done(result, (int)self);
+            delete job;
+        }
+    }
+
+    void wake_all() {
+        {
+            // 確保 worker 不會在檢查條件之後、開始等待之前錯過通知
+            std::lock_guard<std::mutex> lock(idle_mutex);
+        }
+        idle.notify_all();
+    }
+
+    int pick(int worker) {
+        if (worker >= 0 && worker < (int)workers.size()) return worker;
+        return (int)(next_worker++ % workers.size());
+    }
+
+public:
+    AiPool(int threads, const OpeningBook* book, size_t tt_megabytes = 16)
+        : stopping(false), next_worker(0), queued(0), running(0), completed(0), stolen(0), cpu_us(0), wait_us(0),
+          ponders(0), ponder_us(0) {
+        if (threads < 1) threads = 1;
+        for (int i = 0; i < threads; i++) {
+            Worker* w = new Worker();
+            w->engine = new Engine(new TranspositionTable(tt_megabytes));
+            w->engine->set_book(book);
+            w->engine->set_stop_flag(&w->stop);
+            workers.push_back(w);
+        }
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i]->thread = std::thread(&AiPool::run, this, i);
+        }
+    }
+
+    ~AiPool() {
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+            stopping = true;
+        }
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i]->stop = true;
+        }
+        idle.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            Worker* w = workers[i];
+            w->thread.join();
+            for (size_t j = 0; j < w->jobs.size(); j++) delete w->jobs[j];
+            TranspositionTable* table = &w->engine->get_table();
+            delete w->engine;
+            delete table;
+            delete w;
+        }
+    }
+
+    // worker 為 -1 時輪流分配，否則放進指定 worker 的佇列（仍可能被別的 worker 偷走）；
+    // 回傳放進哪一個 worker。done 會收到實際搜尋的 worker。
+    int submit(const Game& game, char player, int budget_ms, int max_depth,
+               const std::function<void(const SearchResult&, int)>& done, int worker = -1) {
+        Job* job = new Job();
+        job->game = game;
+        job->player = player;
+        job->budget_ms = budget_ms;
+        job->max_depth = max_depth;
+        job->done = done;
+        job->queued_at = Engine::Clock::now();
+
+        // 先加計數再放進佇列，被拿走時才不會減到負的
+        queued++;
+        int index = pick(worker);
+        Worker* w = workers[index];
+        {
+            std::lock_guard<std::mutex> lock(w->mutex);
+            w->jobs.push_back(job);
+            // 真正的工作優先，正在 ponder 就停下來
+            if (w->pondering) w->stop = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+        }
+        idle.notify_one();
+        return index;
+    }
+
+    // 輪到對手時請 worker 替對手（opponent）想；token 用來認出是哪一局（例如房間編號）。
+    // 同一個 worker 只留最新的一個 ponder。回傳用哪一個 worker。
+    int ponder(int worker, const Game& game, char opponent, uint64_t token) {
+        int index = pick(worker);
+        Worker* w = workers[index];
+        {
+            std::lock_guard<std::mutex> lock(w->mutex);
+            w->ponder_game = game;
+            w->ponder_player = opponent;
+            w->ponder_token = token;
+            w->has_ponder = true;
+            if (w->pondering) w->stop = true;
+        }
+        wake_all();
+        return index;
+    }
+
+    // 對手下了或對局結束：這一局的 ponder 不用再做
+    void stop_ponder(int worker, uint64_t token) {
+        if (worker < 0 || worker >= (int)workers.size()) return;
+        Worker* w = workers[worker];
+        std::lock_guard<std::mutex> lock(w->mutex);
+        if (w->has_ponder.load() && w->ponder_token == token) w->has_ponder = false;
+        if (w->pondering == token) w->stop = true;
+    }
+
+    int threads() const { return (int)workers.size(); }
+    uint64_t queue_depth() const { return queued.load(); }
+    uint64_t busy() const { return running.load(); }
+    uint64_t jobs_completed() const { return completed.load(); }
+    uint64_t jobs_stolen() const { return stolen.load(); }
+    uint64_t cpu_microseconds() const { return cpu_us.load(); }
+    uint64_t wait_microseconds() const { return wait_us.load(); }
+    uint64_t ponders_started() const { return ponders.load(); }
+    uint64_t ponder_microseconds() const { return ponder_us.load(); }
+};
+
+#endif // AI_POOL_HPP
@@ -0,0 +1,275 @@
+#ifndef ANALYSIS_HPP
+#define ANALYSIS_HPP
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include "game.hpp"
+#include "engine.hpp"
+#include "transposition.hpp"
+
+// 一個局面的分析結果；分數以輪到的一方為視角，單位同 Engine（1/100 顆棋子）
+struct PlyAnalysis {
+    uint64_t game_id;
+    int ply;                    // 第幾個局面（0 為第一步之前）
+    char player;                // 輪到誰
+    int best_move;              // square（row * 8 + col）
+    int score;                  // 最佳步的分數
+    int depth;                  // 搜尋深度；完美解時為空格數
+    int played;                 // 實際下的那一步，-1 為不知道（單獨的盤面或最後一個局面）
+    int played_score;           // 實際那一步的分數（由下一個局面的分數換算）
+    int mistake;                // score - played_score，不小於 0
+
+    bool has_played() const { return played >= 0; }
+};
+
+// 要分析的一局：由棋步重播，或一組互不相關的盤面
+struct AnalysisGame {
+    uint64_t id;                // 呼叫端自訂，原樣放回結果
+    std::vector<Game> positions;
+    std::vector<char> players;  // 各局面輪到誰；'*' 為終局
+    std::vector<int> played;    // positions[i] 之後下的那一步，-1 為沒有
+
+    // squares 同 ArchivedGame::moves（每步一個位元組，pass 不記）；有不合法的棋步時回傳 false
+    static bool from_moves(uint64_t game_id, const std::string& squares, AnalysisGame& out) {
+        out.id = game_id;
+        out.positions.clear();
+        out.players.clear();
+        out.played.clear();
+        Game game;
+        char player = 'X';
+        for (size_t i = 0; i <= squares.size(); i++) {
+            player = to_move(game, player);
+            out.positions.push_back(game);
+            out.players.push_back(player);
+            if (i == squares.size()) {
+                out.played.push_back(-1);
+                break;
+            }
+            int sq = (uint8_t)squares[i];
+            if (player == '*' || sq >= 64 || !game.make_move(sq / 8, sq % 8, player)) return false;
+            out.played.push_back(sq);
+            player = (player == 'X') ? 'O' : 'X';
+        }
+        return true;
+    }
+
+    // boards 為 get_board_state() 格式（64 個字元），可再接一個字元指定輪到誰；
+    // 沒指定時由 X 先，X 不能下才換 O
+    static bool from_boards(uint64_t game_id, const std::vector<std::string>& boards, AnalysisGame& out) {
+        out.id = game_id;
+        out.positions.clear();
+        out.players.clear();
+        out.played.clear();
+        for (size_t i = 0; i < boards.size(); i++) {
+            const std::string& b = boards[i];
+            if (b.size() != 64 && b.size() != 65) return false;
+            Game game;
+            game.set_board_state(b.substr(0, 64));
+            char player = (b.size() == 65) ? b[64] : 'X';
+            if (player != 'X' && player != 'O') return false;
+            out.positions.push_back(game);
+            out.players.push_back(to_move(game, player));
+            out.played.push_back(-1);
+        }
+        return true;
+    }
+
+    // player 不能下時換對方；雙方都不能下為 '*'
+    static char to_move(Game& game, char player) {
+        if (game.has_valid_moves(player)) return player;
+        char other = (player == 'X') ? 'O' : 'X';
+        return game.has_valid_moves(other) ? other : '*';
+    }
+};
+
+// 整批局面分給 N 條執行緒，共用一張置換表：同一局相鄰的局面幾乎是同一棵樹，
+// 一條執行緒搜過的節點另一條直接用得到。局面依序取用，所以同一局的局面會同時在不同執行緒上搜。
+// 每個局面一搜完就經 callback 送出（不保證順序）；實際下的那一步的分數要等下一個局面搜完才知道，
+// 所以要算失誤的局面會等到下一個局面也搜完才送出。
+// callback 在 worker 執行緒上呼叫，同一時間只會有一個。
+class Analyzer {
+public:
+    typedef std::function<void(const PlyAnalysis&)> Callback;
+
+private:
+    struct Task {
+        size_t game;
+        size_t index;
+    };
+
+    // 每個局面的狀態，由 mutex 保護
+    struct Slot {
+        SearchResult result;
+        int x_score;            // 以 X 為視角，方便和下一個局面比較
+        int reply_x_score;      // 少搜一層的分數，給上一個局面當實際那一步的分數
+        bool done;
+        bool sent;
+    };
+
+    TranspositionTable table;
+    std::vector<Engine*> engines;
+    int depth;
+    int exact_empties;
+
+    std::mutex mutex;
+    std::vector<std::vector<Slot> > slots;
+    const std::vector<AnalysisGame>* games;
+    std::vector<Task> tasks;
+    std::atomic<size_t> next_task;
+    Callback callback;
+    unsigned long long total_nodes;
+
+    Analyzer(const Analyzer&);
+    Analyzer& operator=(const Analyzer&);
+
+    static int final_x_score(const Game& game) {
+        int diff = Bitboard::popcount(game.get_pieces('X')) - Bitboard::popcount(game.get_pieces('O'));
+        int empties = 64 - Bitboard::popcount(game.get_pieces('X') | game.get_pieces('O'));
+        if (diff > 0) diff += empties;
+        else if (diff < 0) diff -= empties;
+        return diff * Engine::DISC;
+    }
+
+    static int empties_of(const Game& game) {
+        return 64 - Bitboard::popcount(game.get_pieces('X') | game.get_pieces('O'));
+    }
+
+    // 呼叫時須持有 mutex
+    void try_send(size_t g, size_t i) {
+        const AnalysisGame& game = (*games)[g];
+        Slot& slot = slots[g][i];
+        if (!slot.done || slot.sent || game.players[i] == '*') return;
+        int sign = (game.players[i] == 'X') ? 1 : -1;
+        PlyAnalysis a;
+        a.game_id = game.id;
+        a.ply = (int)i;
+        a.player = game.players[i];
+        a.best_move = slot.result.is_pass() ? -1 : slot.result.row * 8 + slot.result.col;
+        a.score = slot.x_score * sign;
+        a.depth = slot.result.depth;
+        a.played = game.played[i];
+        a.played_score = a.score;
+        a.mistake = 0;
+        if (a.has_played()) {
+            if (i + 1 >= slots[g].size() || !slots[g][i + 1].done) return;
+            a.played_score = slots[g][i + 1].reply_x_score * sign;
+            if (a.played == a.best_move) a.played_score = a.score;
+            a.mistake = a.score > a.played_score ? a.score - a.played_score : 0;
+        }
+        slot.sent = true;
+        callback(a);
+    }
+
+    void run(Engine* engine) {
+        while (true) {
+            size_t t = next_task.fetch_add(1);
+            if (t >= tasks.size()) return;
+            size_t g = tasks[t].game, i = tasks[t].index;
+            const AnalysisGame& game = (*games)[g];
+
+            SearchResult result;
+            int x_score, reply_x_score;
+            char player = game.players[i];
+            if (player == '*') {
+                x_score = reply_x_score = final_x_score(game.positions[i]);
+            } else {
+                int sign = (player == 'X') ? 1 : -1;
+                bool exact = empties_of(game.positions[i]) <= exact_empties;
+                Engine::Clock::time_point forever = Engine::Clock::now() + std::chrono::hours(24);
+                engine->clear();
+
+                // 上一步的分數要和上一個局面的最佳步同一種搜尋：上一個局面搜 depth 層（其中一層是那一步本身）
+                // 時這裡搜 depth - 1 層，不然奇偶層的差異會被當成失誤；剛進入解到底的範圍時也一樣，
+                // 不然上一個局面評估值的誤差會被當成失誤。兩邊都解到底時直接用完美解。
+                // 先搜的這一次會把置換表填好，第二次幾乎不花時間
+                bool has_reply = i > 0 && game.played[i - 1] >= 0;
+                bool reply_exact = has_reply && exact && empties_of(game.positions[i - 1]) <= exact_empties;
+                reply_x_score = 0;
+                if (has_reply && !reply_exact) {
+                    SearchResult reply = engine->search(game.positions[i], player, forever, depth > 1 ? depth - 1 : 1);
+                    reply_x_score = sign * reply.score;
+                    result.nodes += reply.nodes;
+                }
+                unsigned long long reply_nodes = result.nodes;
+                result = engine->search(game.positions[i], player, forever, exact ? 60 : depth);
+                result.nodes += reply_nodes;
+                x_score = sign * result.score;
+                if (!has_reply || reply_exact) reply_x_score = x_score;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            total_nodes += result.nodes;
+            Slot& slot = slots[g][i];
+            slot.result = result;
+            slot.x_score = x_score;
+            slot.reply_x_score = reply_x_score;
+            slot.done = true;
+            try_send(g, i);
+            if (i > 0) try_send(g, i - 1);
+        }
+    }
+
+public:
+    // 每條執行緒一個 Engine，共用 table；depth 為一般局面的搜尋深度，
+    // 空格不超過 exact_empties 時解到底（最多到 Engine::ENDGAME_EMPTIES）
+    explicit Analyzer(int threads = 1, size_t tt_megabytes = 64, int search_depth = 10, int exact = 14)
+        : table(tt_megabytes), depth(search_depth), exact_empties(exact), games(NULL), next_task(0), total_nodes(0) {
+        if (threads < 1) threads = 1;
+        if (exact_empties > Engine::ENDGAME_EMPTIES) exact_empties = Engine::ENDGAME_EMPTIES;
+        if (threads > TranspositionTable::MAX_SHARDS - 1) threads = TranspositionTable::MAX_SHARDS - 1;
+        for (int i = 0; i < threads; i++) {
+            Engine* e = new Engine(&table);
+            // 各自搜不同的局面：計數器分片錯開，但都要解殘局；換代由 analyze() 統一做
+            e->set_thread_id(i + 1);
+            e->set_helper(false);
+            engines.push_back(e);
+        }
+    }
+
+    ~Analyzer() {
+        for (size_t i = 0; i < engines.size(); i++) delete engines[i];
+    }
+
+    // 分析整批對局，全部送出後才返回；回傳分析了幾個局面（不含終局）
+    size_t analyze(const std::vector<AnalysisGame>& batch, const Callback& done) {
+        games = &batch;
+        callback = done;
+        slots.assign(batch.size(), std::vector<Slot>());
+        tasks.clear();
+        size_t count = 0;
+        for (size_t g = 0; g < batch.size(); g++) {
+            Slot empty = {SearchResult(), 0, 0, false, false};
+            slots[g].assign(batch[g].positions.size(), empty);
+            for (size_t i = 0; i < batch[g].positions.size(); i++) {
+                Task t = {g, i};
+                tasks.push_back(t);
+                if (batch[g].players[i] != '*') count++;
+            }
+        }
+        next_task.store(0);
+        total_nodes = 0;
+        table.new_search();
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < engines.size(); i++) {
+            threads.push_back(std::thread(&Analyzer::run, this, engines[i]));
+        }
+        run(engines[0]);
+        for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+
+        games = NULL;
+        callback = Callback();
+        return count;
+    }
+
+    int get_threads() const { return (int)engines.size(); }
+    unsigned long long get_nodes() const { return total_nodes; }
+    TranspositionTable& get_table() { return table; }
+};
+
+#endif // ANALYSIS_HPP
@@ -0,0 +1,242 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include "game.hpp"
+#include "analysis.hpp"
+#include "archive.hpp"
+#include "eval.hpp"
+
+// 對局分析工具：每個局面的最佳步、分數，以及實際下的那一步損失多少
+//
+// 來源三選一：
+//   --archive <file>  伺服器的對局記錄（--archive 寫出的檔案），整份分析
+//   --moves <list>    一局的棋步，例如 f5d6c3d3c4（pass 不寫）
+//   --boards <file>   每行一個盤面（get_board_state 格式，可再接 X 或 O 指定輪到誰），- 為標準輸入
+// 每個局面一行，搜完就印出（不照順序）；最後印出每秒分析的局面數。
+
+typedef std::chrono::steady_clock Clock;
+
+static void usage(const char* prog) {
+    std::cout << "Usage: " << prog << " (--archive <file> | --moves <list> | --boards <file>) [options]\n"
+              << "  --threads <n>   worker threads sharing one transposition table (default: all cores)\n"
+              << "  --depth <n>     search depth per position (default 10)\n"
+              << "  --exact <n>     solve positions with at most this many empties exactly (default 14)\n"
+              << "  --tt <mb>       transposition table size (default 64)\n"
+              << "  --batch <n>     games per batch when reading an archive (default 256)\n"
+              << "  --limit <n>     analyze at most this many games\n"
+              << "  --weights <file> evaluation weights written by trainer (default: built-in)\n"
+              << "  --quiet         print only the summary\n";
+}
+
+static std::string square_name(int sq) {
+    if (sq < 0) return "pass";
+    std::string s;
+    s += (char)('a' + sq % 8);
+    s += (char)('8' - sq / 8);
+    return s;
+}
+
+static std::string discs(int score) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << std::showpos << score / (double)Engine::DISC;
+    return out.str();
+}
+
+// "f5d6c3" → 每步一個位元組
+static bool parse_moves(const std::string& text, std::string& squares) {
+    Game game;
+    squares.clear();
+    std::string compact;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] != ' ' && text[i] != ',') compact += text[i];
+    }
+    if (compact.size() % 2 != 0) return false;
+    for (size_t i = 0; i < compact.size(); i += 2) {
+        int row, col;
+        if (!game.parse_move(compact.substr(i, 2), row, col)) return false;
+        squares += (char)(row * 8 + col);
+    }
+    return true;
+}
+
+struct Totals {
+    unsigned long long positions;
+    unsigned long long judged;          // 有實際棋步可比較的局面
+    long long mistake_sum;
+    unsigned long long blunders;        // 損失 4 顆以上
+
+    Totals() : positions(0), judged(0), mistake_sum(0), blunders(0) {}
+};
+
+int main(int argc, char* argv[]) {
+    std::string archive_path, moves_text, boards_path, weights_path;
+    int threads = (int)std::thread::hardware_concurrency();
+    int depth = 10, exact = 14, batch_size = 256;
+    size_t tt_mb = 64;
+    long long limit = -1;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--archive" && i + 1 < argc) {
+            archive_path = argv[++i];
+        } else if (arg == "--moves" && i + 1 < argc) {
+            moves_text = argv[++i];
+        } else if (arg == "--boards" && i + 1 < argc) {
+            boards_path = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--depth" && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if (arg == "--exact" && i + 1 < argc) {
+            exact = atoi(argv[++i]);
+        } else if (arg == "--tt" && i + 1 < argc) {
+            tt_mb = atoi(argv[++i]);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch_size = atoi(argv[++i]);
+        } else if (arg == "--limit" && i + 1 < argc) {
+            limit = atoll(argv[++i]);
+        } else if (arg == "--weights" && i + 1 < argc) {
+            weights_path = argv[++i];
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    int sources = !archive_path.empty() + !moves_text.empty() + !boards_path.empty();
+    if (sources != 1 || depth < 1 || batch_size < 1 || tt_mb < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+
+    WeightFile weights;
+    if (!weights_path.empty()) {
+        if (!weights.open(weights_path, Evaluator::instance())) {
+            std::cerr << "Cannot load weights " << weights_path << "\n";
+            return 1;
+        }
+        Evaluator::instance().set_weights(weights.weights());
+    }
+
+    // 先把來源整理成一串對局，之後分批送進 Analyzer
+    std::vector<AnalysisGame> games;
+    std::vector<ArchivedGame> archived;
+    if (!archive_path.empty()) {
+        if (!GameArchive::read(archive_path, archived)) {
+            std::cerr << "Cannot read archive " << archive_path << "\n";
+            return 1;
+        }
+    } else if (!moves_text.empty()) {
+        std::string squares;
+        AnalysisGame g;
+        if (!parse_moves(moves_text, squares) || !AnalysisGame::from_moves(0, squares, g)) {
+            std::cerr << "Invalid move list\n";
+            return 1;
+        }
+        games.push_back(g);
+    } else {
+        std::ifstream file;
+        if (boards_path != "-") {
+            file.open(boards_path.c_str());
+            if (!file) {
+                std::cerr << "Cannot open " << boards_path << "\n";
+                return 1;
+            }
+        }
+        std::istream& in = (boards_path == "-") ? std::cin : file;
+        std::vector<std::string> boards;
+        std::string line;
+        int line_no = 0;
+        while (std::getline(in, line)) {
+            line_no++;
+            if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+            if (line.empty() || line[0] == '#') continue;
+            std::vector<std::string> one(1, line);
+            AnalysisGame g;
+            if (!AnalysisGame::from_boards(0, one, g)) {
+                std::cerr << "line " << line_no << ": invalid board, skipped\n";
+                continue;
+            }
+            boards.push_back(line);
+        }
+        AnalysisGame g;
+        AnalysisGame::from_boards(0, boards, g);
+        games.push_back(g);
+    }
+
+    Analyzer analyzer(threads, tt_mb, depth, exact);
+    std::cerr << "Analyzing with " << analyzer.get_threads() << " thread" << (analyzer.get_threads() > 1 ? "s" : "")
+              << ", depth " << depth << ", exact at " << exact << " empties\n";
+
+    Totals totals;
+    Analyzer::Callback print = [&totals, quiet](const PlyAnalysis& a) {
+        totals.positions++;
+        if (a.has_played()) {
+            totals.judged++;
+            totals.mistake_sum += a.mistake;
+            if (a.mistake >= 4 * Engine::DISC) totals.blunders++;
+        }
+        if (quiet) return;
+        std::ostringstream line;
+        line << "game " << a.game_id << " ply " << a.ply << " " << a.player
+             << "  best " << square_name(a.best_move) << " " << discs(a.score)
+             << "  depth " << a.depth;
+        if (a.has_played()) {
+            line << "  played " << square_name(a.played) << " " << discs(a.played_score)
+                 << "  mistake " << std::fixed << std::setprecision(2) << a.mistake / (double)Engine::DISC;
+        }
+        std::cout << line.str() << "\n";
+    };
+
+    Clock::time_point begin = Clock::now();
+    unsigned long long nodes = 0;
+    size_t game_count = 0;
+    if (archived.empty()) {
+        analyzer.analyze(games, print);
+        nodes += analyzer.get_nodes();
+        game_count = games.size();
+    } else {
+        // 記錄檔可能有上百萬局，一次只展開一批的局面
+        size_t next = 0;
+        while (next < archived.size() && (limit < 0 || (long long)game_count < limit)) {
+            games.clear();
+            while (next < archived.size() && (int)games.size() < batch_size &&
+                   (limit < 0 || (long long)(game_count + games.size()) < limit)) {
+                const ArchivedGame& saved = archived[next++];
+                AnalysisGame g;
+                if (saved.moves.empty()) continue;
+                if (!AnalysisGame::from_moves(saved.id, saved.moves, g)) {
+                    std::cerr << "game " << saved.id << ": invalid move record, skipped\n";
+                    continue;
+                }
+                games.push_back(g);
+            }
+            analyzer.analyze(games, print);
+            nodes += analyzer.get_nodes();
+            game_count += games.size();
+        }
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+    if (elapsed <= 0) elapsed = 1e-9;
+
+    std::cerr << std::fixed << std::setprecision(0)
+              << game_count << " game" << (game_count == 1 ? "" : "s") << ", " << totals.positions << " positions in "
+              << std::setprecision(2) << elapsed << "s  ("
+              << std::setprecision(1) << totals.positions / elapsed << " positions/s, "
+              << std::setprecision(0) << nodes / elapsed << " nodes/s)\n";
+    if (totals.judged > 0) {
+        std::cerr << std::setprecision(2) << "average mistake " << totals.mistake_sum / (double)totals.judged / Engine::DISC
+                  << " discs per move, " << totals.blunders << " move" << (totals.blunders == 1 ? "" : "s")
+                  << " losing 4 or more discs\n";
+    }
+    return 0;
+}
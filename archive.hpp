@@ -0,0 +1,335 @@
+#ifndef ARCHIVE_HPP
+#define ARCHIVE_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "game.hpp"
+
+// 對局記錄檔（只附加，little-endian）：
+//
+//   "RVLOG001"
+//   record*            每筆 [type u8][game id varint][內容]
+//     REC_START        [start_ms u64][len u8][X 的名字][len u8][O 的名字]
+//     REC_MOVES        [count u8][square u8 × count]   square = row * 8 + col
+//     REC_END          [end_ms u64][len u8][結果]
+//
+// 每步只記一個位元組；pass 不記，重播時由規則推算。
+// 同一局在一次寫入之間的棋步合併成一筆 REC_MOVES，所以走得越快越接近一步一個位元組。
+// 伺服器異常結束時最後一筆可能只寫了一半，讀取時停在最後一筆完整的記錄。
+struct ArchivedGame {
+    uint64_t id;
+    uint64_t started_ms;        // Unix 時間
+    uint64_t ended_ms;          // 未結束為 0
+    std::string names[2];       // X、O
+    std::string moves;
+    std::string result;
+    bool finished;
+
+    ArchivedGame() : id(0), started_ms(0), ended_ms(0), finished(false) {}
+
+    // 把棋步套到 game 上，to_move 為之後輪到的一方（雙方都不能下時為 '*'）；
+    // 記錄裡有不合法的棋步時回傳 false
+    bool replay(Game& game, char& to_move) const {
+        char player = 'X';
+        for (size_t i = 0; i < moves.size(); i++) {
+            if (!game.has_valid_moves(player)) player = (player == 'X') ? 'O' : 'X';
+            int sq = (uint8_t)moves[i];
+            if (sq >= 64 || !game.make_move(sq / 8, sq % 8, player)) return false;
+            player = (player == 'X') ? 'O' : 'X';
+        }
+        if (!game.has_valid_moves(player)) {
+            char other = (player == 'X') ? 'O' : 'X';
+            player = game.has_valid_moves(other) ? other : '*';
+        }
+        to_move = player;
+        return true;
+    }
+};
+
+// 寫入端：reactor 只把記錄放進記憶體就返回，由背景執行緒 write + fdatasync。
+// 每次同步後至少隔 sync_interval_ms 才做下一次，期間進來的記錄一起同步（group commit），
+// 所以不論同時有多少局，每一步都不用等磁碟；當機時最多遺失這段間隔內的棋步。
+// 寫入執行緒只在閒置時才需要叫醒，忙的時候新記錄不必發 notify。
+class GameArchive {
+public:
+    enum RecordType { REC_START = 1, REC_MOVES = 2, REC_END = 3 };
+    // 名字與結果最長幾個位元組（長度欄位為 u8），超過的部分不記；
+    // 接續對局以名字比對，所以伺服器收的名字不能比這個長
+    static const size_t MAX_STRING = 255;
+
+private:
+    int fd;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::string pending;                                // 已編碼、等待寫出的記錄
+    std::unordered_map<uint64_t, std::string> moves;    // 還沒編碼的棋步，依對局合併
+    bool stopping;
+    bool idle;                                          // 寫入執行緒在等新記錄
+    std::chrono::milliseconds sync_interval;
+    uint64_t logged_moves;
+    uint64_t flushes;
+    uint64_t flushed_bytes;
+
+    GameArchive(const GameArchive&);
+    GameArchive& operator=(const GameArchive&);
+
+    static void put_varint(std::string& out, uint64_t v) {
+        while (v >= 0x80) {
+            out += (char)((v & 0x7F) | 0x80);
+            v >>= 7;
+        }
+        out += (char)v;
+    }
+
+    static void put_u64(std::string& out, uint64_t v) {
+        for (int i = 0; i < 8; i++) out += (char)((v >> (8 * i)) & 0xFF);
+    }
+
+    static void put_string(std::string& out, const std::string& s) {
+        size_t n = s.size() < MAX_STRING ? s.size() : MAX_STRING;
+        out += (char)n;
+        out.append(s, 0, n);
+    }
+
+    static uint64_t wall_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // 呼叫時須持有 mutex
+    void encode_moves(uint64_t id, const std::string& squares) {
+        for (size_t i = 0; i < squares.size(); i += 255) {
+            size_t n = squares.size() - i < 255 ? squares.size() - i : 255;
+            pending += (char)REC_MOVES;
+            put_varint(pending, id);
+            pending += (char)n;
+            pending.append(squares, i, n);
+        }
+    }
+
+    void write_loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            while (!stopping && pending.empty() && moves.empty()) {
+                idle = true;
+                wake.wait(lock);
+            }
+            idle = false;
+            if (pending.empty() && moves.empty()) return;
+
+            for (std::unordered_map<uint64_t, std::string>::const_iterator it = moves.begin(); it != moves.end(); ++it) {
+                encode_moves(it->first, it->second);
+            }
+            moves.clear();
+            std::string batch;
+            batch.swap(pending);
+            lock.unlock();
+
+            size_t written = 0;
+            while (written < batch.size()) {
+                ssize_t n = write(fd, batch.data() + written, batch.size() - written);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+                written += n;
+            }
+            fdatasync(fd);
+
+            lock.lock();
+            flushes++;
+            flushed_bytes += written;
+            if (!stopping) wake.wait_for(lock, sync_interval);
+        }
+    }
+
+    // 解析到最後一筆完整的記錄為止；回傳有效長度
+    static size_t parse(const std::string& data, std::vector<ArchivedGame>& games) {
+        std::unordered_map<uint64_t, size_t> index;
+        size_t pos = 8;
+        while (pos < data.size()) {
+            size_t p = pos;
+            uint8_t type = (uint8_t)data[p++];
+            uint64_t id = 0;
+            int shift = 0;
+            while (true) {
+                if (p >= data.size() || shift > 63) return pos;
+                uint8_t b = (uint8_t)data[p++];
+                id |= (uint64_t)(b & 0x7F) << shift;
+                shift += 7;
+                if (!(b & 0x80)) break;
+            }
+
+            if (type == REC_START) {
+                ArchivedGame g;
+                g.id = id;
+                if (!get_u64(data, p, g.started_ms) || !get_string(data, p, g.names[0]) ||
+                    !get_string(data, p, g.names[1])) return pos;
+                index[id] = games.size();
+                games.push_back(g);
+            } else if (type == REC_MOVES) {
+                if (p >= data.size()) return pos;
+                size_t n = (uint8_t)data[p++];
+                if (data.size() - p < n) return pos;
+                std::unordered_map<uint64_t, size_t>::iterator it = index.find(id);
+                if (it != index.end()) games[it->second].moves.append(data, p, n);
+                p += n;
+            } else if (type == REC_END) {
+                uint64_t ended;
+                std::string result;
+                if (!get_u64(data, p, ended) || !get_string(data, p, result)) return pos;
+                std::unordered_map<uint64_t, size_t>::iterator it = index.find(id);
+                if (it != index.end()) {
+                    ArchivedGame& g = games[it->second];
+                    g.ended_ms = ended;
+                    g.result = result;
+                    g.finished = true;
+                }
+            } else {
+                return pos;
+            }
+            pos = p;
+        }
+        return pos;
+    }
+
+    static bool get_u64(const std::string& data, size_t& p, uint64_t& v) {
+        if (data.size() - p < 8) return false;
+        v = 0;
+        for (int i = 0; i < 8; i++) v |= (uint64_t)(uint8_t)data[p + i] << (8 * i);
+        p += 8;
+        return true;
+    }
+
+    static bool get_string(const std::string& data, size_t& p, std::string& s) {
+        if (p >= data.size()) return false;
+        size_t n = (uint8_t)data[p++];
+        if (data.size() - p < n) return false;
+        s.assign(data, p, n);
+        p += n;
+        return true;
+    }
+
+    static bool read_file(int f, std::string& data) {
+        struct stat st;
+        if (fstat(f, &st) < 0) return false;
+        data.resize(st.st_size);
+        size_t got = 0;
+        while (got < data.size()) {
+            ssize_t n = pread(f, &data[got], data.size() - got, got);
+            if (n <= 0) return false;
+            got += n;
+        }
+        return true;
+    }
+
+public:
+    explicit GameArchive(int sync_interval_ms = 10)
+        : fd(-1), stopping(false), idle(false), sync_interval(sync_interval_ms),
+          logged_moves(0), flushes(0), flushed_bytes(0) {}
+
+    ~GameArchive() {
+        if (writer.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            writer.join();
+        }
+        if (fd != -1) close(fd);
+    }
+
+    // 讀出檔案裡所有對局（依開局順序）；檔案不存在或格式不對時回傳 false
+    static bool read(const std::string& path, std::vector<ArchivedGame>& games) {
+        int f = ::open(path.c_str(), O_RDONLY);
+        if (f < 0) return false;
+        std::string data;
+        bool ok = read_file(f, data) && data.size() >= 8 && memcmp(data.data(), "RVLOG001", 8) == 0;
+        close(f);
+        if (ok) parse(data, games);
+        return ok;
+    }
+
+    // 開啟（或建立）記錄檔並啟動寫入執行緒；unfinished 為上次沒有結束的對局，
+    // max_id 為檔案裡最大的對局編號，新對局的編號要比它大。
+    // 尾端不完整的記錄會被截掉，之後的記錄才接得上。
+    bool open(const std::string& path, std::vector<ArchivedGame>& unfinished, uint64_t& max_id) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) return false;
+
+        std::string data;
+        if (!read_file(fd, data)) return false;
+        max_id = 0;
+        if (data.empty()) {
+            std::string header("RVLOG001");
+            if (write(fd, header.data(), header.size()) != (ssize_t)header.size()) return false;
+        } else {
+            if (data.size() < 8 || memcmp(data.data(), "RVLOG001", 8) != 0) return false;
+            std::vector<ArchivedGame> games;
+            size_t valid = parse(data, games);
+            if (valid < data.size() && ftruncate(fd, valid) < 0) return false;
+            for (size_t i = 0; i < games.size(); i++) {
+                if (games[i].id > max_id) max_id = games[i].id;
+                if (!games[i].finished) unfinished.push_back(games[i]);
+            }
+        }
+
+        writer = std::thread(&GameArchive::write_loop, this);
+        return true;
+    }
+
+    void start(uint64_t id, const std::string& x_name, const std::string& o_name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending += (char)REC_START;
+        put_varint(pending, id);
+        put_u64(pending, wall_ms());
+        put_string(pending, x_name);
+        put_string(pending, o_name);
+        if (idle) wake.notify_one();
+    }
+
+    void move(uint64_t id, int square) {
+        std::lock_guard<std::mutex> lock(mutex);
+        moves[id] += (char)square;
+        logged_moves++;
+        if (idle) wake.notify_one();
+    }
+
+    void end(uint64_t id, const std::string& result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        // 這一局還沒寫出的棋步要排在 REC_END 之前
+        std::unordered_map<uint64_t, std::string>::iterator it = moves.find(id);
+        if (it != moves.end()) {
+            encode_moves(id, it->second);
+            moves.erase(it);
+        }
+        pending += (char)REC_END;
+        put_varint(pending, id);
+        put_u64(pending, wall_ms());
+        put_string(pending, result);
+        if (idle) wake.notify_one();
+    }
+
+    // 記了幾步、寫入執行緒做過幾次 fdatasync、總共寫了多少位元組
+    void stats(uint64_t& move_count, uint64_t& sync_count, uint64_t& bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        move_count = logged_moves;
+        sync_count = flushes;
+        bytes = flushed_bytes;
+    }
+};
+
+#endif // ARCHIVE_HPP
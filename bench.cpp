@@ -0,0 +1,439 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include "game.hpp"
+#include "engine.hpp"
+#include "smp.hpp"
+#include "endgame.hpp"
+#include "eval.hpp"
+#include "mcts.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchPosition {
+    Game game;
+    char player;
+};
+
+static double seconds_since(Clock::time_point begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+// 從初始局面以固定種子隨機下 plies 步，產生可重現的測試局面
+static std::vector<BenchPosition> make_positions(int count, int plies, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<BenchPosition> positions;
+    while ((int)positions.size() < count) {
+        BenchPosition pos;
+        pos.player = 'X';
+        bool ok = true;
+        for (int i = 0; i < plies; i++) {
+            if (!pos.game.has_valid_moves(pos.player)) {
+                pos.player = (pos.player == 'X') ? 'O' : 'X';
+                if (!pos.game.has_valid_moves(pos.player)) {
+                    ok = false;
+                    break;
+                }
+            }
+            std::vector<std::pair<int, int>> moves = pos.game.get_valid_moves(pos.player);
+            std::pair<int, int> m = moves[rng() % moves.size()];
+            pos.game.make_move(m.first, m.second, pos.player);
+            pos.player = (pos.player == 'X') ? 'O' : 'X';
+        }
+        if (ok && pos.game.has_valid_moves(pos.player)) {
+            positions.push_back(pos);
+        }
+    }
+    return positions;
+}
+
+// 固定深度下，比較 1 個執行緒與 N 個執行緒的花費時間
+static int bench_smp(int argc, char* argv[]) {
+    int depth = (argc >= 1) ? atoi(argv[0]) : 10;
+    int max_threads = (argc >= 2) ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    if (max_threads < 1) max_threads = 1;
+
+    std::vector<BenchPosition> positions = make_positions(8, 20, 2024);
+    std::cout << "Lazy SMP, depth " << depth << ", " << positions.size() << " positions\n";
+
+    std::vector<int> counts;
+    for (int t = 1; t < max_threads; t *= 2) counts.push_back(t);
+    counts.push_back(max_threads);
+
+    double base_time = 0;
+    for (size_t c = 0; c < counts.size(); c++) {
+        int threads = counts[c];
+        ParallelSearch search(threads);
+        unsigned long long nodes = 0;
+
+        Clock::time_point begin = Clock::now();
+        for (size_t i = 0; i < positions.size(); i++) {
+            search.clear();
+            search.search(positions[i].game, positions[i].player,
+                          Clock::now() + std::chrono::hours(1), depth);
+            nodes += search.get_nodes();
+        }
+        double elapsed = seconds_since(begin);
+        if (threads == 1) base_time = elapsed;
+
+        TTStats st = search.get_table().get_stats();
+        std::cout << std::fixed
+                  << "threads " << std::setw(3) << threads
+                  << std::setprecision(3) << "  time " << std::setw(8) << elapsed << "s"
+                  << "  nodes " << std::setw(12) << nodes
+                  << std::setprecision(0) << "  " << std::setw(10) << nodes / elapsed << " nodes/s"
+                  << std::setprecision(2) << "  speedup " << base_time / elapsed << "x"
+                  << "  tt hit " << 100 * st.hit_rate() << "%\n";
+    }
+    return 0;
+}
+
+// FFO 終局測試局面（fforum-40-59）中已核對過的題目。
+// 盤面字串為 get_board_state() 格式（第一列為 a8..h8）；
+// 最佳步也以本專案的座標表示（FFO 原始座標的列號上下顛倒）。
+struct FfoPosition {
+    int id;
+    const char* board;
+    char player;
+    int score;
+    const char* best_moves;
+};
+
+static const FfoPosition FFO_POSITIONS[] = {
+    {40, "O**OOOOX*OOOOOOXOOXXOOOXOOXOOOXXOOOOOOXX***OOOOX****O**X********", 'X', 38, "a7"},
+    {41, "*OOOOO****OOOOX**OOOOOO*XXXXXOO**XXOOX**OOXOXX****OXXO***OOO**O*", 'X', 0, "h5"},
+    {42, "**OOO*******XX*OOOOOOXOO*OOOOXOOX*OOOXXO***OOXOO***OOOXO**OOOO**", 'X', 6, "g7"},
+    {44, "**O*X*O***O*XO*O*OOXXXOOOOOOXXXOOOOOXX**XXOOXO****XXXX*****XXX**", 'O', -14, "d7 b1"},
+};
+
+static std::string square_name(int sq) {
+    if (sq < 0) return "pass";
+    std::string s;
+    s += (char)('a' + sq % 8);
+    s += (char)('8' - sq / 8);
+    return s;
+}
+
+// 完美解 FFO 局面，回報每題時間與 nodes/s，並核對分數
+static int bench_ffo(int argc, char* argv[]) {
+    int megabytes = (argc >= 1) ? atoi(argv[0]) : 64;
+    EndgameSolver solver(megabytes);
+
+    int count = sizeof(FFO_POSITIONS) / sizeof(FFO_POSITIONS[0]);
+    int failures = 0;
+    unsigned long long total_nodes = 0;
+    double total_time = 0;
+
+    for (int i = 0; i < count; i++) {
+        const FfoPosition& pos = FFO_POSITIONS[i];
+        std::string board(pos.board);
+        int empties = 0;
+        for (size_t j = 0; j < board.size(); j++) {
+            if (board[j] == '*') empties++;
+        }
+
+        solver.clear();
+        Clock::time_point begin = Clock::now();
+        EndgameResult r = solver.solve(board, pos.player);
+        double elapsed = seconds_since(begin);
+
+        std::string move = square_name(r.move);
+        bool ok = (r.score == pos.score) &&
+                  std::string(pos.best_moves).find(move) != std::string::npos;
+        if (!ok) failures++;
+        total_nodes += r.nodes;
+        total_time += elapsed;
+
+        std::cout << std::fixed
+                  << "#" << pos.id << "  empties " << empties
+                  << "  score " << std::setw(3) << std::showpos << r.score << std::noshowpos
+                  << "  move " << move
+                  << "  nodes " << std::setw(11) << r.nodes
+                  << std::setprecision(3) << "  time " << std::setw(7) << elapsed << "s"
+                  << std::setprecision(0) << "  " << std::setw(9) << r.nodes / elapsed << " nodes/s  "
+                  << (ok ? "OK" : "WRONG") << "\n";
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "total " << total_time << "s, "
+              << std::setprecision(0) << total_nodes / total_time << " nodes/s, "
+              << failures << " wrong\n";
+    return failures ? 1 : 0;
+}
+
+// 評估函式微基準：增量更新索引 vs. 每次從頭計算
+static int bench_eval(int argc, char* argv[]) {
+    int rounds = (argc >= 1) ? atoi(argv[0]) : 200;
+    const Evaluator& ev = Evaluator::instance();
+
+    // 每個局面記下由初始局面出發的落子序列，增量版沿路更新索引
+    struct Line {
+        std::vector<int> squares;
+        std::vector<uint64_t> flips;
+        std::vector<char> players;
+        std::vector<uint64_t> black, white;
+    };
+    std::mt19937 rng(7);
+    std::vector<Line> lines;
+    for (int g = 0; g < 64; g++) {
+        Line line;
+        Game game;
+        char player = 'X';
+        while (!game.is_game_over()) {
+            if (!game.has_valid_moves(player)) player = (player == 'X') ? 'O' : 'X';
+            uint64_t mask = game.get_move_mask(player);
+            int n = rng() % Bitboard::popcount(mask);
+            while (n-- > 0) mask &= mask - 1;
+            int sq = __builtin_ctzll(mask);
+            line.squares.push_back(sq);
+            line.players.push_back(player);
+            line.flips.push_back(game.do_move(sq, player));
+            line.black.push_back(game.get_pieces('X'));
+            line.white.push_back(game.get_pieces('O'));
+            player = game.get_current_player();
+        }
+        lines.push_back(line);
+    }
+
+    long long evals = 0, checksum = 0;
+    Clock::time_point begin = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t g = 0; g < lines.size(); g++) {
+            const Line& line = lines[g];
+            Evaluator::State st;
+            Game start;
+            ev.init_state(st, start.get_pieces('X'), start.get_pieces('O'));
+            for (size_t i = 0; i < line.squares.size(); i++) {
+                ev.update(st, line.squares[i], line.flips[i], line.players[i]);
+                checksum += ev.evaluate(st, line.black[i], line.white[i], 'X');
+                evals++;
+            }
+        }
+    }
+    double incremental = seconds_since(begin);
+
+    long long check_scratch = 0;
+    begin = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t g = 0; g < lines.size(); g++) {
+            const Line& line = lines[g];
+            for (size_t i = 0; i < line.squares.size(); i++) {
+                check_scratch += ev.evaluate(line.black[i], line.white[i], 'X');
+            }
+        }
+    }
+    double scratch = seconds_since(begin);
+
+    std::cout << std::fixed << std::setprecision(0)
+              << "evaluations  " << evals << "\n"
+              << "incremental  " << std::setw(10) << evals / incremental << " evals/s\n"
+              << "from scratch " << std::setw(10) << evals / scratch << " evals/s\n"
+              << "weights      " << ev.weight_count() * sizeof(int16_t) / 1024 << " KB, "
+              << Evaluator::PHASES << " phases\n";
+    if (checksum != check_scratch) {
+        std::cout << "MISMATCH: incremental and from-scratch scores differ\n";
+        return 1;
+    }
+    return 0;
+}
+
+// 對手思考時先替對手想（Engine::ponder）：在相同深度下比較對手下完後要花多久才下出下一步。
+// 每個局面：我方搜 depth 層後下一步，對手以較淺的搜尋回應（模擬真人，不一定照預料下），
+// 冷啟動只帶著我方自己那次搜尋留下的置換表；ponder 則在對手想的 ponder_ms 內先搜對手的局面。
+static int bench_ponder(int argc, char* argv[]) {
+    int depth = (argc >= 1) ? atoi(argv[0]) : 10;
+    int ponder_ms = (argc >= 2) ? atoi(argv[1]) : 500;
+
+    std::vector<BenchPosition> positions = make_positions(12, 16, 2025);
+    std::cout << "Pondering, depth " << depth << ", " << ponder_ms << " ms on the opponent's time, "
+              << positions.size() << " positions\n";
+
+    Engine cold, warm, opponent;
+    double cold_time = 0, warm_time = 0;
+    unsigned long long cold_nodes = 0, warm_nodes = 0;
+    int measured = 0, predicted = 0, same_move = 0;
+    for (size_t i = 0; i < positions.size(); i++) {
+        const Game& start = positions[i].game;
+        char me = positions[i].player;
+        char opp = (me == 'X') ? 'O' : 'X';
+        Clock::time_point forever = Clock::now() + std::chrono::hours(1);
+
+        // 兩個引擎都從同一個狀態出發：清空的置換表，搜完自己的一步
+        cold.get_table().clear();
+        warm.get_table().clear();
+        cold.clear();
+        warm.clear();
+        SearchResult mine = cold.search(start, me, forever, depth);
+        warm.search(start, me, forever, depth);
+        Game after = start;
+        if (mine.is_pass() || !after.make_move(mine.row, mine.col, me) || !after.has_valid_moves(opp)) continue;
+
+        SearchResult guess = warm.ponder(after, opp, NULL, Clock::now() + std::chrono::milliseconds(ponder_ms));
+        opponent.get_table().clear();
+        opponent.clear();
+        SearchResult reply = opponent.search(after, opp, forever, 4);
+        if (reply.row == guess.row && reply.col == guess.col) predicted++;
+        after.make_move(reply.row, reply.col, opp);
+        if (!after.has_valid_moves(me)) continue;
+
+        Clock::time_point begin = Clock::now();
+        SearchResult a = cold.search(after, me, forever, depth);
+        cold_time += seconds_since(begin);
+        cold_nodes += a.nodes;
+
+        begin = Clock::now();
+        SearchResult b = warm.search(after, me, forever, depth);
+        warm_time += seconds_since(begin);
+        warm_nodes += b.nodes;
+
+        if (a.row == b.row && a.col == b.col) same_move++;
+        measured++;
+    }
+    if (measured == 0) {
+        std::cout << "no positions measured\n";
+        return 1;
+    }
+
+    std::cout << std::fixed
+              << "cold start  " << std::setprecision(1) << std::setw(8) << 1000 * cold_time / measured
+              << " ms/move  " << std::setw(12) << cold_nodes / measured << " nodes/move\n"
+              << "pondered    " << std::setw(8) << 1000 * warm_time / measured
+              << " ms/move  " << std::setw(12) << warm_nodes / measured << " nodes/move\n"
+              << std::setprecision(2) << "speedup     " << cold_time / warm_time << "x"
+              << "  reply predicted " << predicted << "/" << measured
+              << "  same move " << same_move << "/" << measured << "\n";
+    return 0;
+}
+
+// ponder 被打斷要多久才停：殘局 ponder 會進完美解，停止旗標必須一路傳進 EndgameSolver。
+// 每個局面在背景 ponder，delay_ms 後設停止旗標，量 ponder 多久返回；超過 10 ms 視為失敗。
+static int bench_ponder_stop(int argc, char* argv[]) {
+    int empties = (argc >= 1) ? atoi(argv[0]) : Engine::ENDGAME_EMPTIES;
+    int delay_ms = (argc >= 2) ? atoi(argv[1]) : 20;
+    if (empties < 1 || empties > 60) empties = Engine::ENDGAME_EMPTIES;
+
+    std::vector<BenchPosition> positions = make_positions(40, 60 - empties, 2026);
+    std::cout << "Stopping a ponder after " << delay_ms << " ms, " << empties << " empties, "
+              << positions.size() << " positions\n";
+
+    Engine engine;
+    double total_ms = 0, worst_ms = 0;
+    int interrupted = 0;
+    for (size_t i = 0; i < positions.size(); i++) {
+        engine.get_table().clear();
+        engine.clear();
+        std::atomic<bool> stop(false);
+        std::atomic<bool> finished(false);
+        Clock::time_point stopped_at;
+        std::thread pondering([&]() {
+            engine.ponder(positions[i].game, positions[i].player, &stop,
+                          Clock::now() + std::chrono::seconds(60));
+            finished = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+        bool early = finished.load();
+        stopped_at = Clock::now();
+        stop = true;
+        pondering.join();
+        if (early) continue;
+
+        double ms = 1000 * seconds_since(stopped_at);
+        total_ms += ms;
+        if (ms > worst_ms) worst_ms = ms;
+        interrupted++;
+    }
+    if (interrupted == 0) {
+        std::cout << "every ponder finished before it was stopped\n";
+        return 0;
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "interrupted " << interrupted << "/" << positions.size()
+              << "  average " << total_ms / interrupted << " ms  worst " << worst_ms << " ms to stop\n";
+    if (worst_ms > 10) {
+        std::cout << "FAIL: a ponder took more than 10 ms to stop\n";
+        return 1;
+    }
+    return 0;
+}
+
+// MCTS tree parallelism：每個局面固定時間，比較不同執行緒數每秒的 playout 次數
+static int bench_mcts(int argc, char* argv[]) {
+    int millis = (argc >= 1) ? atoi(argv[0]) : 500;
+    int max_threads = (argc >= 2) ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    if (max_threads < 1) max_threads = 1;
+
+    std::vector<BenchPosition> positions = make_positions(8, 20, 2024);
+    std::cout << "MCTS, " << millis << " ms per position, " << positions.size() << " positions\n";
+
+    std::vector<int> counts;
+    for (int t = 1; t < max_threads; t *= 2) counts.push_back(t);
+    counts.push_back(max_threads);
+
+    const MctsSearch::Playout policies[] = {MctsSearch::RANDOM, MctsSearch::PATTERN};
+    const char* names[] = {"random", "pattern"};
+    double base_rate[2] = {0, 0};
+    MctsSearch search(1, 1 << 22);
+    for (size_t c = 0; c < counts.size(); c++) {
+        int threads = counts[c];
+        search.set_threads(threads);
+        std::cout << "threads " << std::setw(3) << threads;
+        for (int p = 0; p < 2; p++) {
+            search.set_playout(policies[p]);
+            unsigned long long playouts = 0;
+            size_t nodes = 0;
+            Clock::time_point begin = Clock::now();
+            for (size_t i = 0; i < positions.size(); i++) {
+                MctsResult r = search.search_for(positions[i].game, positions[i].player, millis);
+                playouts += r.playouts;
+                nodes += r.nodes;
+            }
+            double rate = playouts / seconds_since(begin);
+            if (threads == 1) base_rate[p] = rate;
+            std::cout << std::fixed << std::setprecision(0)
+                      << "  " << names[p] << " " << std::setw(9) << rate << " playouts/s"
+                      << std::setprecision(2) << " (" << rate / base_rate[p] << "x, "
+                      << std::setprecision(0) << nodes / positions.size() << " nodes)";
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
+
+struct BenchCommand {
+    const char* name;
+    const char* usage;
+    int (*run)(int argc, char* argv[]);
+};
+
+static const BenchCommand COMMANDS[] = {
+    {"smp", "smp [depth] [max_threads]", bench_smp},
+    {"ffo", "ffo [tt_megabytes]", bench_ffo},
+    {"eval", "eval [rounds]", bench_eval},
+    {"ponder", "ponder [depth] [ponder_ms]", bench_ponder},
+    {"ponder_stop", "ponder_stop [empties] [delay_ms]", bench_ponder_stop},
+    {"mcts", "mcts [ms_per_position] [max_threads]", bench_mcts},
+};
+
+int main(int argc, char* argv[]) {
+    int count = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+    if (argc >= 2) {
+        for (int i = 0; i < count; i++) {
+            if (COMMANDS[i].name == std::string(argv[1])) {
+                return COMMANDS[i].run(argc - 2, argv + 2);
+            }
+        }
+    }
+
+    std::cout << "Usage: " << argv[0] << " <command> [args]\n";
+    for (int i = 0; i < count; i++) {
+        std::cout << "  " << COMMANDS[i].usage << "\n";
+    }
+    return 1;
+}
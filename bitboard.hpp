@@ -0,0 +1,121 @@
+#ifndef BITBOARD_HPP
+#define BITBOARD_HPP
+
+#include <cstdint>
+
+// 位元棋盤：第 (row * 8 + col) 個 bit 代表棋盤上的 (row, col)
+// a8 = bit 0，h1 = bit 63，與 get_board_state() 的字元順序相同
+class Bitboard {
+private:
+    // 左移為正、右移為負；mask 清掉橫向跨行繞回的格子
+    static inline uint64_t shift(uint64_t b, int s, uint64_t mask) {
+        return (s > 0 ? (b << s) : (b >> -s)) & mask;
+    }
+
+    // Kogge-Stone occluded fill：從 gen 出發，沿著 pro 往同一方向擴散
+    static inline uint64_t fill(uint64_t gen, uint64_t pro, int s, uint64_t mask) {
+        pro &= mask;
+        gen |= pro & shift(gen, s, ~0ULL);
+        pro &= shift(pro, s, ~0ULL);
+        gen |= pro & shift(gen, 2 * s, ~0ULL);
+        pro &= shift(pro, 2 * s, ~0ULL);
+        gen |= pro & shift(gen, 4 * s, ~0ULL);
+        return gen;
+    }
+
+    static inline uint64_t moves_dir(uint64_t P, uint64_t O, uint64_t empty, int s, uint64_t mask) {
+        uint64_t line = fill(P, O, s, mask) & O;
+        return shift(line, s, mask) & empty;
+    }
+
+    static inline uint64_t flips_dir(uint64_t m, uint64_t P, uint64_t O, int s, uint64_t mask) {
+        uint64_t line = fill(m, O, s, mask);
+        uint64_t hit = shift(line, s, mask) & P;
+        return line & O & (0ULL - (uint64_t)(hit != 0));
+    }
+
+public:
+    static const uint64_t NOT_A_FILE = 0xFEFEFEFEFEFEFEFEULL;
+    static const uint64_t NOT_H_FILE = 0x7F7F7F7F7F7F7F7FULL;
+
+    static inline uint64_t square(int row, int col) {
+        return 1ULL << (row * 8 + col);
+    }
+
+    static inline int popcount(uint64_t b) {
+        return __builtin_popcountll(b);
+    }
+
+    // 取出並清除最低位的 bit，回傳其索引
+    static inline int pop_lsb(uint64_t& b) {
+        int sq = __builtin_ctzll(b);
+        b &= b - 1;
+        return sq;
+    }
+
+    // P 為要下的一方，O 為對手；回傳所有合法落子位置
+    static inline uint64_t get_moves(uint64_t P, uint64_t O) {
+        uint64_t empty = ~(P | O);
+        uint64_t moves = 0;
+        moves |= moves_dir(P, O, empty,  1, NOT_A_FILE);
+        moves |= moves_dir(P, O, empty, -1, NOT_H_FILE);
+        moves |= moves_dir(P, O, empty,  8, ~0ULL);
+        moves |= moves_dir(P, O, empty, -8, ~0ULL);
+        moves |= moves_dir(P, O, empty,  9, NOT_A_FILE);
+        moves |= moves_dir(P, O, empty,  7, NOT_H_FILE);
+        moves |= moves_dir(P, O, empty, -7, NOT_A_FILE);
+        moves |= moves_dir(P, O, empty, -9, NOT_H_FILE);
+        return moves;
+    }
+
+    // 與 P 相鄰的空格（對手 O 的潛在行動力來源）
+    static inline uint64_t get_frontier_empties(uint64_t P, uint64_t O) {
+        uint64_t n = ((P << 1) & NOT_A_FILE) | ((P >> 1) & NOT_H_FILE)
+                   | (P << 8) | (P >> 8)
+                   | ((P << 9) & NOT_A_FILE) | ((P >> 9) & NOT_H_FILE)
+                   | ((P << 7) & NOT_H_FILE) | ((P >> 7) & NOT_A_FILE);
+        return n & ~(P | O);
+    }
+
+    // 上下翻轉：第 r 列換到第 7 - r 列
+    static inline uint64_t flip_vertical(uint64_t b) {
+        return __builtin_bswap64(b);
+    }
+
+    // 左右翻轉：第 c 行換到第 7 - c 行
+    static inline uint64_t flip_horizontal(uint64_t b) {
+        b = ((b >> 1) & 0x5555555555555555ULL) | ((b & 0x5555555555555555ULL) << 1);
+        b = ((b >> 2) & 0x3333333333333333ULL) | ((b & 0x3333333333333333ULL) << 2);
+        b = ((b >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((b & 0x0F0F0F0F0F0F0F0FULL) << 4);
+        return b;
+    }
+
+    // 轉置：(row, col) 換到 (col, row)
+    static inline uint64_t transpose(uint64_t b) {
+        uint64_t t;
+        t = 0x0F0F0F0F00000000ULL & (b ^ (b << 28));
+        b ^= t ^ (t >> 28);
+        t = 0x3333000033330000ULL & (b ^ (b << 14));
+        b ^= t ^ (t >> 14);
+        t = 0x5500550055005500ULL & (b ^ (b << 7));
+        b ^= t ^ (t >> 7);
+        return b;
+    }
+
+    // 在 sq 落子會翻轉的棋子；不合法時回傳 0
+    static inline uint64_t get_flips(uint64_t P, uint64_t O, int sq) {
+        uint64_t m = 1ULL << sq;
+        uint64_t flips = 0;
+        flips |= flips_dir(m, P, O,  1, NOT_A_FILE);
+        flips |= flips_dir(m, P, O, -1, NOT_H_FILE);
+        flips |= flips_dir(m, P, O,  8, ~0ULL);
+        flips |= flips_dir(m, P, O, -8, ~0ULL);
+        flips |= flips_dir(m, P, O,  9, NOT_A_FILE);
+        flips |= flips_dir(m, P, O,  7, NOT_H_FILE);
+        flips |= flips_dir(m, P, O, -7, NOT_A_FILE);
+        flips |= flips_dir(m, P, O, -9, NOT_H_FILE);
+        return flips;
+    }
+};
+
+#endif // BITBOARD_HPP
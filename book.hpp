@@ -0,0 +1,208 @@
+#ifndef BOOK_HPP
+#define BOOK_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "bitboard.hpp"
+#include "game.hpp"
+
+// 開局庫檔案格式（little-endian，直接 mmap 使用，不需解析）：
+//
+//   BookHeader
+//   BookEntry[count]   依 (player, opponent, move) 由小到大排序
+//
+// 局面以「要下的一方 / 對手」兩個位元棋盤表示，並取 8 種對稱中最小的一個
+// 當作標準形；move 也是標準形座標。同一局面的每個候選步各佔一筆。
+struct BookHeader {
+    char magic[8];          // "RVBOOK01"
+    uint32_t entry_size;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+struct BookEntry {
+    uint64_t player;
+    uint64_t opponent;
+    int16_t score;          // 以要下的一方為視角的平均終局差（棋子數）
+    uint16_t games;         // 出現次數（超過 65535 時停在上限）
+    uint8_t move;
+    uint8_t padding[3];
+};
+
+// 查詢結果，move 已換回呼叫端的座標
+struct BookMove {
+    int move;
+    int score;
+    int games;
+};
+
+class OpeningBook {
+private:
+    int fd;
+    void* mapping;
+    size_t mapped_size;
+    const BookEntry* entries;
+    size_t count;
+
+    OpeningBook(const OpeningBook&);
+    OpeningBook& operator=(const OpeningBook&);
+
+    static bool less(const BookEntry& e, uint64_t P, uint64_t O) {
+        return e.player < P || (e.player == P && e.opponent < O);
+    }
+
+    // 第一筆 >= (P, O) 的位置
+    size_t lower_bound(uint64_t P, uint64_t O) const {
+        size_t lo = 0, hi = count;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (less(entries[mid], P, O)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+public:
+    static const char* magic() { return "RVBOOK01"; }
+
+    OpeningBook() : fd(-1), mapping(NULL), mapped_size(0), entries(NULL), count(0) {}
+
+    ~OpeningBook() {
+        close();
+    }
+
+    // 對稱變換 t：bit2 先轉置，bit0 左右翻，bit1 上下翻（與 eval.hpp 相同）
+    static uint64_t transform(uint64_t b, int t) {
+        if (t & 4) b = Bitboard::transpose(b);
+        if (t & 1) b = Bitboard::flip_horizontal(b);
+        if (t & 2) b = Bitboard::flip_vertical(b);
+        return b;
+    }
+
+    static int transform_square(int sq, int t) {
+        int r = sq / 8, c = sq % 8;
+        if (t & 4) { int tmp = r; r = c; c = tmp; }
+        if (t & 1) c = 7 - c;
+        if (t & 2) r = 7 - r;
+        return r * 8 + c;
+    }
+
+    // transform_square 的反函數
+    static int inverse_square(int sq, int t) {
+        int r = sq / 8, c = sq % 8;
+        if (t & 2) r = 7 - r;
+        if (t & 1) c = 7 - c;
+        if (t & 4) { int tmp = r; r = c; c = tmp; }
+        return r * 8 + c;
+    }
+
+    // 把 (P, O) 換成標準形，回傳所用的對稱變換
+    static int canonicalize(uint64_t& P, uint64_t& O) {
+        uint64_t best_p = P, best_o = O;
+        int best_t = 0;
+        for (int t = 1; t < 8; t++) {
+            uint64_t p = transform(P, t), o = transform(O, t);
+            if (p < best_p || (p == best_p && o < best_o)) {
+                best_p = p;
+                best_o = o;
+                best_t = t;
+            }
+        }
+        P = best_p;
+        O = best_o;
+        return best_t;
+    }
+
+    bool open(const std::string& path) {
+        close();
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BookHeader)) {
+            close();
+            return false;
+        }
+        mapped_size = (size_t)st.st_size;
+        mapping = mmap(NULL, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = NULL;
+            close();
+            return false;
+        }
+
+        const BookHeader* header = static_cast<const BookHeader*>(mapping);
+        if (memcmp(header->magic, magic(), 8) != 0 ||
+            header->entry_size != sizeof(BookEntry) ||
+            mapped_size != sizeof(BookHeader) + header->count * sizeof(BookEntry)) {
+            close();
+            return false;
+        }
+        // 查詢是跳躍式的二分搜尋，不需要預讀
+        madvise(mapping, mapped_size, MADV_RANDOM);
+
+        entries = reinterpret_cast<const BookEntry*>(header + 1);
+        count = (size_t)header->count;
+        return true;
+    }
+
+    void close() {
+        if (mapping) munmap(mapping, mapped_size);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        mapping = NULL;
+        mapped_size = 0;
+        entries = NULL;
+        count = 0;
+    }
+
+    bool is_open() const { return entries != NULL; }
+    size_t size() const { return count; }
+
+    // 列出 (P, O) 在開局庫中的所有候選步，最多 max 筆；回傳筆數
+    int lookup(uint64_t P, uint64_t O, BookMove* out, int max) const {
+        if (!entries) return 0;
+        int t = canonicalize(P, O);
+        int n = 0;
+        for (size_t i = lower_bound(P, O); i < count && n < max; i++) {
+            const BookEntry& e = entries[i];
+            if (e.player != P || e.opponent != O) break;
+            out[n].move = inverse_square(e.move, t);
+            out[n].score = e.score;
+            out[n].games = e.games;
+            n++;
+        }
+        return n;
+    }
+
+    // 分數最高的候選步（同分取出現較多次者）；至少出現 min_games 次才採用
+    bool best_move(uint64_t P, uint64_t O, BookMove& best, int min_games = 1) const {
+        BookMove moves[64];
+        int n = lookup(P, O, moves, 64);
+        bool found = false;
+        for (int i = 0; i < n; i++) {
+            if (moves[i].games < min_games) continue;
+            if (!found || moves[i].score > best.score ||
+                (moves[i].score == best.score && moves[i].games > best.games)) {
+                best = moves[i];
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    bool best_move(const Game& game, char player, BookMove& best, int min_games = 1) const {
+        char opponent = (player == 'X') ? 'O' : 'X';
+        return best_move(game.get_pieces(player), game.get_pieces(opponent), best, min_games);
+    }
+};
+
+#endif // BOOK_HPP
@@ -0,0 +1,162 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include "game.hpp"
+#include "book.hpp"
+
+// 從棋譜建立開局庫
+//
+// 棋譜為文字檔，每行一盤：
+//   f5d6c3d3c4f4 ... [黑白終局差]
+// 落子以兩個字元表示（與伺服器協定相同），無子可下時自動 pass，
+// 可省略的第二欄為 X（黑）減 O（白）的終局棋子差；省略時棋譜必須下到終局。
+// 以 # 開頭的行為註解。
+
+struct Key {
+    uint64_t player;
+    uint64_t opponent;
+    int move;
+
+    bool operator<(const Key& o) const {
+        if (player != o.player) return player < o.player;
+        if (opponent != o.opponent) return opponent < o.opponent;
+        return move < o.move;
+    }
+};
+
+struct Stat {
+    long long score_sum;
+    long long games;
+
+    Stat() : score_sum(0), games(0) {}
+};
+
+// 解析並重播一行棋譜；成功時 plies 為實際落子，final_diff 為黑白差
+static bool replay(const std::string& moves, const std::string& score_field,
+                   std::vector<std::pair<int, char> >& plies, int& final_diff) {
+    Game game;
+    char player = 'X';
+    plies.clear();
+
+    for (size_t i = 0; i + 1 < moves.size(); i += 2) {
+        int row, col;
+        if (!game.parse_move(moves.substr(i, 2), row, col)) return false;
+        if (!game.has_valid_moves(player)) {
+            player = (player == 'X') ? 'O' : 'X';
+        }
+        if (!game.is_valid_move(row, col, player)) return false;
+        game.make_move(row, col, player);
+        plies.push_back(std::make_pair(row * 8 + col, player));
+        player = (player == 'X') ? 'O' : 'X';
+    }
+    if (moves.size() % 2 != 0) return false;
+
+    if (!score_field.empty()) {
+        char* end = NULL;
+        final_diff = (int)strtol(score_field.c_str(), &end, 10);
+        return *end == '\0';
+    }
+    if (!game.is_game_over()) return false;
+    final_diff = game.get_black_count() - game.get_white_count();
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " <records.txt> <book.bin> [max_plies] [min_games]\n";
+        return 1;
+    }
+    int max_plies = (argc >= 4) ? atoi(argv[3]) : 20;
+    int min_games = (argc >= 5) ? atoi(argv[4]) : 2;
+
+    std::ifstream in(argv[1]);
+    if (!in) {
+        std::cerr << "Cannot open " << argv[1] << "\n";
+        return 1;
+    }
+
+    std::map<Key, Stat> stats;
+    std::string line;
+    int line_no = 0, used = 0, skipped = 0;
+    std::vector<std::pair<int, char> > plies;
+
+    while (std::getline(in, line)) {
+        line_no++;
+        std::istringstream fields(line);
+        std::string moves, score_field;
+        if (!(fields >> moves) || moves[0] == '#') continue;
+        fields >> score_field;
+
+        int final_diff = 0;
+        if (!replay(moves, score_field, plies, final_diff)) {
+            std::cerr << "line " << line_no << ": invalid record, skipped\n";
+            skipped++;
+            continue;
+        }
+        used++;
+
+        // 再走一次，把前 max_plies 步記到標準形局面上
+        Game game;
+        for (size_t i = 0; i < plies.size() && (int)i < max_plies; i++) {
+            char player = plies[i].second;
+            char opponent = (player == 'X') ? 'O' : 'X';
+            Key key;
+            key.player = game.get_pieces(player);
+            key.opponent = game.get_pieces(opponent);
+            int t = OpeningBook::canonicalize(key.player, key.opponent);
+            key.move = OpeningBook::transform_square(plies[i].first, t);
+
+            Stat& s = stats[key];
+            s.score_sum += (player == 'X') ? final_diff : -final_diff;
+            s.games++;
+
+            game.do_move(plies[i].first, player);
+        }
+    }
+
+    std::vector<BookEntry> entries;
+    for (std::map<Key, Stat>::const_iterator it = stats.begin(); it != stats.end(); ++it) {
+        if (it->second.games < min_games) continue;
+        BookEntry e;
+        memset(&e, 0, sizeof(e));
+        e.player = it->first.player;
+        e.opponent = it->first.opponent;
+        e.move = (uint8_t)it->first.move;
+        long long n = it->second.games;
+        long long sum = it->second.score_sum;
+        e.score = (int16_t)((sum >= 0 ? sum + n / 2 : sum - n / 2) / n);   // 四捨五入
+        e.games = (uint16_t)(n > 65535 ? 65535 : n);
+        entries.push_back(e);
+    }
+
+    BookHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, OpeningBook::magic(), 8);
+    header.entry_size = sizeof(BookEntry);
+    header.count = entries.size();
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out) {
+        std::cerr << "Cannot write " << argv[2] << "\n";
+        return 1;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    if (!entries.empty()) {
+        ok = ok && fwrite(&entries[0], sizeof(BookEntry), entries.size(), out) == entries.size();
+    }
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Write failed: " << argv[2] << "\n";
+        return 1;
+    }
+
+    std::cout << "Games used: " << used << ", skipped: " << skipped << "\n";
+    std::cout << "Positions/moves seen: " << stats.size() << ", written: " << entries.size()
+              << " (min " << min_games << " games, first " << max_plies << " plies)\n";
+    return 0;
+}
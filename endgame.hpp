@@ -0,0 +1,366 @@
+#ifndef ENDGAME_HPP
+#define ENDGAME_HPP
+
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include "bitboard.hpp"
+#include "zobrist.hpp"
+#include "transposition.hpp"
+
+// 終局解算結果：score 為要下的一方最後的淨勝子數（空格歸勝方）
+struct EndgameResult {
+    int score;
+    int move;                  // 0..63，-1 代表必須 pass 或已終局
+    unsigned long long nodes;
+    bool aborted;              // 超過 deadline 或被要求停止時為 true，score 不可信
+
+    EndgameResult() : score(0), move(-1), nodes(0), aborted(false) {}
+};
+
+// 殘局完美解：最後 1~4 格有專用函式，其餘用
+// 置換表 + 最快優先（對手行動力最少的先搜）+ 象限奇偶排序 + 穩定子剪枝
+class EndgameSolver {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    TranspositionTable table;
+    unsigned long long nodes;
+    Clock::time_point deadline;
+    const std::atomic<bool>* stop_flag;  // 外部要求停止（例如 ponder 被打斷）
+    bool aborted;
+
+    static const int SCORE_MAX = 64;
+    static const int TT_MIN_EMPTIES = 8;     // 空格少於此數不查置換表
+    static const int FASTEST_FIRST_EMPTIES = 7;
+
+    static const uint64_t ROW_0 = 0x00000000000000FFULL;
+    static const uint64_t ROW_7 = 0xFF00000000000000ULL;
+    static const uint64_t FILE_A = 0x0101010101010101ULL;
+    static const uint64_t FILE_H = 0x8080808080808080ULL;
+
+    static int final_score(uint64_t P, uint64_t O) {
+        int p = Bitboard::popcount(P);
+        int o = Bitboard::popcount(O);
+        int diff = p - o;
+        int empties = 64 - p - o;
+        if (diff > 0) return diff + empties;
+        if (diff < 0) return diff - empties;
+        return 0;
+    }
+
+    // 奇數空格的象限優先（奇偶策略）
+    static uint64_t odd_quadrants(uint64_t empty) {
+        static const uint64_t quadrant[4] = {
+            0x000000000F0F0F0FULL, 0x00000000F0F0F0F0ULL,
+            0x0F0F0F0F00000000ULL, 0xF0F0F0F000000000ULL,
+        };
+        uint64_t odd = 0;
+        for (int q = 0; q < 4; q++) {
+            if (Bitboard::popcount(empty & quadrant[q]) & 1) odd |= quadrant[q];
+        }
+        return odd;
+    }
+
+    // 整條填滿的橫、直、兩種斜線（這些線上的子不可能再被翻）
+    static void full_lines(uint64_t filled, uint64_t full[4]) {
+        uint64_t h = 0, v = 0, d7 = 0, d9 = 0;
+        for (int r = 0; r < 8; r++) {
+            uint64_t row = ROW_0 << (8 * r);
+            if ((filled & row) == row) h |= row;
+        }
+        for (int c = 0; c < 8; c++) {
+            uint64_t col = FILE_A << c;
+            if ((filled & col) == col) v |= col;
+        }
+        for (int i = 0; i < 15; i++) {
+            uint64_t a = diagonal9(i), b = diagonal7(i);
+            if ((filled & a) == a) d9 |= a;
+            if ((filled & b) == b) d7 |= b;
+        }
+        full[0] = h;
+        full[1] = v;
+        full[2] = d9;
+        full[3] = d7;
+    }
+
+    // 左上到右下（row - col 固定）的第 i 條斜線
+    static uint64_t diagonal9(int i) {
+        uint64_t m = 0;
+        for (int r = 0; r < 8; r++) {
+            int c = r - (i - 7);
+            if (c >= 0 && c < 8) m |= 1ULL << (r * 8 + c);
+        }
+        return m;
+    }
+
+    // 右上到左下（row + col 固定）的第 i 條斜線
+    static uint64_t diagonal7(int i) {
+        uint64_t m = 0;
+        for (int r = 0; r < 8; r++) {
+            int c = i - r;
+            if (c >= 0 && c < 8) m |= 1ULL << (r * 8 + c);
+        }
+        return m;
+    }
+
+
+    int solve_1(uint64_t P, uint64_t O, int sq) {
+        nodes++;
+        int p = Bitboard::popcount(P);
+        int n = Bitboard::popcount(Bitboard::get_flips(P, O, sq));
+        if (n) return 2 * (p + n + 1) - 64;
+
+        n = Bitboard::popcount(Bitboard::get_flips(O, P, sq));
+        if (n) return 2 * (p - n) - 64;
+
+        // 雙方都不能下最後一格
+        int diff = 2 * p - 63;
+        return diff > 0 ? diff + 1 : diff - 1;
+    }
+
+    // 2~4 格：依奇偶排序後直接展開，不做走步產生以外的額外工作
+    int solve_small(uint64_t P, uint64_t O, int alpha, int beta, int n_empties, bool passed) {
+        uint64_t empty = ~(P | O);
+        if (n_empties == 1) {
+            return solve_1(P, O, __builtin_ctzll(empty));
+        }
+        nodes++;
+
+        int order[4], count = 0;
+        uint64_t odd = odd_quadrants(empty);
+        uint64_t e = empty & odd;
+        while (e) order[count++] = Bitboard::pop_lsb(e);
+        e = empty & ~odd;
+        while (e) order[count++] = Bitboard::pop_lsb(e);
+
+        int best = -SCORE_MAX - 1;
+        for (int i = 0; i < count; i++) {
+            int sq = order[i];
+            uint64_t flips = Bitboard::get_flips(P, O, sq);
+            if (!flips) continue;
+            int score = -solve_small(O & ~flips, P | flips | (1ULL << sq), -beta, -alpha, n_empties - 1, false);
+            if (score > best) {
+                best = score;
+                if (score > alpha) {
+                    alpha = score;
+                    if (alpha >= beta) return best;
+                }
+            }
+        }
+
+        if (best == -SCORE_MAX - 1) {
+            if (passed) return final_score(P, O);
+            return -solve_small(O, P, -beta, -alpha, n_empties, true);
+        }
+        return best;
+    }
+
+    int solve(uint64_t P, uint64_t O, int alpha, int beta, int n_empties, bool passed, int* best_move) {
+        if (n_empties <= 4) {
+            return solve_small(P, O, alpha, beta, n_empties, passed);
+        }
+
+        nodes++;
+        // 16 空格時一個節點底下還有整棵小殘局，停止旗標要看得比時鐘勤
+        if ((nodes & 255) == 0) {
+            if ((stop_flag && stop_flag->load(std::memory_order_relaxed)) ||
+                ((nodes & 4095) == 0 && Clock::now() >= deadline)) {
+                aborted = true;
+            }
+        }
+        if (aborted) return 0;
+
+        uint64_t moves = Bitboard::get_moves(P, O);
+        if (!moves) {
+            if (passed) return final_score(P, O);
+            return -solve(O, P, -beta, -alpha, n_empties, true, NULL);
+        }
+
+        // 穩定子剪枝：對手的穩定子決定了我方分數的上限
+        if (alpha >= 64 - 2 * Bitboard::popcount(O)) {
+            int upper = 64 - 2 * Bitboard::popcount(get_stable(O, P));
+            if (upper <= alpha) return upper;
+            if (upper < beta) beta = upper;
+        }
+
+        uint64_t key = 0;
+        int hint = -1;
+        bool use_tt = n_empties >= TT_MIN_EMPTIES;
+        if (use_tt) {
+            key = Zobrist::hash_board(P, O);
+            TTData entry;
+            if (table.probe(key, entry)) {
+                if (entry.move >= 0 && !(moves >> entry.move & 1)) {
+                    table.record_collision();
+                } else {
+                    hint = entry.move;
+                    if (entry.depth >= n_empties && !best_move) {
+                        if (entry.bound == TranspositionTable::EXACT) return entry.score;
+                        if (entry.bound == TranspositionTable::LOWER && entry.score >= beta) return entry.score;
+                        if (entry.bound == TranspositionTable::UPPER && entry.score <= alpha) return entry.score;
+                    }
+                }
+            }
+        }
+
+        int list[32], scores[32], count = 0;
+        uint64_t odd = odd_quadrants(~(P | O));
+        uint64_t m = moves;
+        while (m) {
+            int sq = Bitboard::pop_lsb(m);
+            int s = 0;
+            if (sq == hint) {
+                s = 1 << 20;
+            } else if (n_empties > FASTEST_FIRST_EMPTIES) {
+                // 最快優先：讓對手可下的步數越少越好，角落加分
+                uint64_t flips = Bitboard::get_flips(P, O, sq);
+                uint64_t nP = P | flips | (1ULL << sq);
+                uint64_t nO = O & ~flips;
+                uint64_t opp_moves = Bitboard::get_moves(nO, nP);
+                s = -16 * Bitboard::popcount(opp_moves)
+                    - 12 * Bitboard::popcount(opp_moves & 0x8100000000000081ULL)
+                    - 2 * Bitboard::popcount(Bitboard::get_frontier_empties(nP, nO));
+                if ((0x8100000000000081ULL >> sq) & 1) s += 8;
+                if ((odd >> sq) & 1) s += 2;
+            } else {
+                if ((odd >> sq) & 1) s += 2;
+            }
+            list[count] = sq;
+            scores[count] = s;
+            count++;
+        }
+        for (int i = 1; i < count; i++) {
+            int sq = list[i], s = scores[i], j = i - 1;
+            while (j >= 0 && scores[j] < s) {
+                list[j + 1] = list[j];
+                scores[j + 1] = scores[j];
+                j--;
+            }
+            list[j + 1] = sq;
+            scores[j + 1] = s;
+        }
+
+        int alpha_orig = alpha;
+        int best = -SCORE_MAX - 1, best_sq = -1;
+        for (int i = 0; i < count; i++) {
+            int sq = list[i];
+            uint64_t flips = Bitboard::get_flips(P, O, sq);
+            uint64_t nP = O & ~flips;
+            uint64_t nO = P | flips | (1ULL << sq);
+
+            int score;
+            if (i == 0) {
+                score = -solve(nP, nO, -beta, -alpha, n_empties - 1, false, NULL);
+            } else {
+                score = -solve(nP, nO, -alpha - 1, -alpha, n_empties - 1, false, NULL);
+                if (score > alpha && score < beta) {
+                    score = -solve(nP, nO, -beta, -alpha, n_empties - 1, false, NULL);
+                }
+            }
+            if (aborted) return 0;
+
+            if (score > best) {
+                best = score;
+                best_sq = sq;
+                if (score > alpha) {
+                    alpha = score;
+                    if (alpha >= beta) break;
+                }
+            }
+        }
+
+        if (best_move) *best_move = best_sq;
+        if (use_tt) {
+            int bound = (best <= alpha_orig) ? TranspositionTable::UPPER
+                      : (best >= beta) ? TranspositionTable::LOWER
+                      : TranspositionTable::EXACT;
+            table.store(key, best_sq, n_empties, best, bound);
+        }
+        return best;
+    }
+
+public:
+    explicit EndgameSolver(size_t tt_megabytes = 64) : table(tt_megabytes), nodes(0), stop_flag(NULL), aborted(false) {}
+
+    // 穩定子：每個方向（橫、直、兩斜）上，該線已填滿，
+    // 或其中一側是牆或己方穩定子
+    static uint64_t get_stable(uint64_t P, uint64_t O) {
+        uint64_t full[4];
+        full_lines(P | O, full);
+
+        uint64_t stable = 0;
+        while (true) {
+            uint64_t h = full[0] | (stable << 1) | (stable >> 1) | FILE_A | FILE_H;
+            uint64_t v = full[1] | (stable << 8) | (stable >> 8) | ROW_0 | ROW_7;
+            uint64_t d9 = full[2] | (stable << 9) | (stable >> 9) | FILE_A | FILE_H | ROW_0 | ROW_7;
+            uint64_t d7 = full[3] | (stable << 7) | (stable >> 7) | FILE_A | FILE_H | ROW_0 | ROW_7;
+            uint64_t next = P & h & v & d9 & d7;
+            if (next == stable) return stable;
+            stable = next;
+        }
+    }
+
+    void clear() {
+        table.clear();
+    }
+
+    // flag 變成 true 時盡快中止（同 deadline，結果為 aborted）
+    void set_stop_flag(const std::atomic<bool>* flag) { stop_flag = flag; }
+
+    // P 為要下的一方；alpha/beta 可以縮小窗口只求勝負
+    EndgameResult solve(uint64_t P, uint64_t O, int alpha = -64, int beta = 64,
+                        Clock::time_point limit = Clock::time_point::max()) {
+        EndgameResult result;
+        nodes = 0;
+        aborted = false;
+        deadline = limit;
+        table.new_search();
+
+        int n_empties = 64 - Bitboard::popcount(P | O);
+        int move = -1;
+        if (n_empties <= 4) {
+            // 小殘局直接逐步找最佳步
+            uint64_t moves = Bitboard::get_moves(P, O);
+            int best = -SCORE_MAX - 1;
+            while (moves) {
+                int sq = Bitboard::pop_lsb(moves);
+                uint64_t flips = Bitboard::get_flips(P, O, sq);
+                int s = -solve_small(O & ~flips, P | flips | (1ULL << sq), -beta, -alpha,
+                                     n_empties - 1, false);
+                if (s > best) {
+                    best = s;
+                    move = sq;
+                    if (s > alpha) alpha = s;
+                    if (alpha >= beta) break;
+                }
+            }
+            result.score = (move >= 0) ? best : solve_small(P, O, alpha, beta, n_empties, false);
+        } else {
+            result.score = solve(P, O, alpha, beta, n_empties, false, &move);
+        }
+
+        result.move = move;
+        result.nodes = nodes;
+        result.aborted = aborted;
+        return result;
+    }
+
+    // 從 Game::get_board_state() 的 64 字元字串解，player 為要下的一方（'X' 或 'O'）
+    EndgameResult solve(const std::string& state, char player,
+                        Clock::time_point limit = Clock::time_point::max()) {
+        uint64_t black = 0, white = 0;
+        for (int i = 0; i < 64 && i < (int)state.size(); i++) {
+            if (state[i] == 'X') black |= 1ULL << i;
+            else if (state[i] == 'O') white |= 1ULL << i;
+        }
+        if (player == 'X') return solve(black, white, -64, 64, limit);
+        return solve(white, black, -64, 64, limit);
+    }
+
+    TranspositionTable& get_table() { return table; }
+};
+
+#endif // ENDGAME_HPP
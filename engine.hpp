@@ -0,0 +1,377 @@
+#ifndef ENGINE_HPP
+#define ENGINE_HPP
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include "game.hpp"
+#include "bitboard.hpp"
+#include "transposition.hpp"
+#include "endgame.hpp"
+#include "eval.hpp"
+#include "book.hpp"
+
+// 搜尋結果：row/col 為 -1 代表沒有合法步（必須 pass）
+struct SearchResult {
+    int row;
+    int col;
+    int score;        // 以要下的一方為視角，單位為 1/100 顆棋子
+    int depth;        // 完整搜完的深度
+    unsigned long long nodes;
+
+    SearchResult() : row(-1), col(-1), score(0), depth(0), nodes(0) {}
+
+    bool is_pass() const { return row < 0; }
+
+    std::string move_string() const {
+        if (is_pass()) return "pass";
+        std::string s;
+        s += (char)('a' + col);
+        s += (char)('8' - row);
+        return s;
+    }
+};
+
+// Negamax alpha-beta + 迭代加深 + PVS
+class Engine {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static const int INF = 1000000;
+    static const int DISC = 100;       // 一顆棋子的分數
+    static const int MAX_PLY = 64;
+    static const int ENDGAME_EMPTIES = 16;  // 空格不超過此數時改用完美解
+
+private:
+    Game board;                        // 搜尋時在這份副本上 do/undo
+    TranspositionTable* tt;
+    bool owns_tt;
+    EndgameSolver* solver;             // 第一次進入殘局時才配置
+    const Evaluator* evaluator;
+    Evaluator::State eval_state;       // 與 board 同步的樣式索引
+    const OpeningBook* book;           // 開局庫（可為 NULL）
+    int thread_id;                     // 置換表計數器分片用
+    bool helper;                       // Lazy SMP 的輔助執行緒：不查開局庫、不解殘局
+    Clock::time_point deadline;
+    const std::atomic<bool>* stop_flag;  // 外部要求停止（平行搜尋時由主執行緒設定）
+    int depth_offset;                  // Lazy SMP 輔助執行緒錯開起始深度
+    bool stopped;
+    unsigned long long nodes;
+
+    int killers[MAX_PLY + 2][2];
+    int history[2][64];
+    int root_best;
+    int root_hint;                     // 上一輪迭代的最佳步，下一輪優先搜
+
+    static const uint64_t CORNERS = 0x8100000000000081ULL;
+    static const uint64_t X_SQUARES = 0x0042000000004200ULL;
+
+    static char other(char player) {
+        return (player == 'X') ? 'O' : 'X';
+    }
+
+    static int side(char player) {
+        return (player == 'X') ? 0 : 1;
+    }
+
+    void check_time() {
+        if ((nodes & 1023) == 0) {
+            if (Clock::now() >= deadline ||
+                (stop_flag && stop_flag->load(std::memory_order_relaxed))) {
+                stopped = true;
+            }
+        }
+    }
+
+    // 終局分數：空格歸勝方
+    int final_score(char player) {
+        int own = Bitboard::popcount(board.get_pieces(player));
+        int opp = Bitboard::popcount(board.get_pieces(other(player)));
+        int empties = 64 - own - opp;
+        int diff = own - opp;
+        if (diff > 0) diff += empties;
+        else if (diff < 0) diff -= empties;
+        return diff * DISC;
+    }
+
+    // 靜態評估：樣式權重 + 行動力（見 eval.hpp）
+    int evaluate(char player) {
+        return evaluator->evaluate(eval_state, board.get_pieces('X'), board.get_pieces('O'), player);
+    }
+
+    Engine(const Engine&);
+    Engine& operator=(const Engine&);
+
+    // 排序用分數：置換表最佳步 > 角 > killer > history，再依對手行動力
+    void order_moves(uint64_t mask, char player, int ply, int hint, int* moves, int& count, bool use_mobility) {
+        int scores[64];
+        count = 0;
+        int s = side(player);
+        while (mask) {
+            int sq = Bitboard::pop_lsb(mask);
+            int score = history[s][sq];
+            if (sq == hint) score += 1 << 30;
+            if (CORNERS >> sq & 1) score += 1 << 24;
+            if (sq == killers[ply][0]) score += 1 << 22;
+            else if (sq == killers[ply][1]) score += 1 << 21;
+            if (X_SQUARES >> sq & 1) score -= 1 << 20;
+            if (use_mobility) {
+                uint64_t flips = board.do_move(sq, player);
+                score -= Bitboard::popcount(board.get_move_mask(other(player))) << 16;
+                board.undo_move(sq, flips, player);
+            }
+            moves[count] = sq;
+            scores[count] = score;
+            count++;
+        }
+
+        // 插入排序，分數高的排前面
+        for (int i = 1; i < count; i++) {
+            int m = moves[i], sc = scores[i], j = i - 1;
+            while (j >= 0 && scores[j] < sc) {
+                moves[j + 1] = moves[j];
+                scores[j + 1] = scores[j];
+                j--;
+            }
+            moves[j + 1] = m;
+            scores[j + 1] = sc;
+        }
+    }
+
+    void record_cutoff(int sq, char player, int ply, int depth) {
+        if (killers[ply][0] != sq) {
+            killers[ply][1] = killers[ply][0];
+            killers[ply][0] = sq;
+        }
+        int& h = history[side(player)][sq];
+        h += depth * depth;
+        if (h > (1 << 15)) {
+            for (int s = 0; s < 2; s++) {
+                for (int i = 0; i < 64; i++) history[s][i] /= 2;
+            }
+        }
+    }
+
+    int negamax(char player, int depth, int alpha, int beta, int ply, bool passed) {
+        nodes++;
+        check_time();
+        if (stopped) return 0;
+
+        if (!board.has_valid_moves(player)) {
+            if (passed || !board.has_valid_moves(other(player))) {
+                return final_score(player);
+            }
+            // pass 不消耗深度，換對手下
+            return -negamax(other(player), depth, -beta, -alpha, ply + 1, true);
+        }
+
+        if (depth <= 0 || ply >= MAX_PLY) {
+            return evaluate(player);
+        }
+
+        uint64_t mask = board.get_move_mask(player);
+        uint64_t key = board.get_hash(player);
+        int hint = -1;
+        TTData entry;
+        if (tt->probe(key, entry, thread_id)) {
+            if (entry.move >= 0 && !(mask >> entry.move & 1)) {
+                tt->record_collision(thread_id);
+            } else {
+                hint = entry.move;
+                if (ply > 0 && entry.depth >= depth) {
+                    if (entry.bound == TranspositionTable::EXACT) return entry.score;
+                    if (entry.bound == TranspositionTable::LOWER && entry.score >= beta) return entry.score;
+                    if (entry.bound == TranspositionTable::UPPER && entry.score <= alpha) return entry.score;
+                }
+            }
+        }
+        if (ply == 0 && root_hint >= 0) hint = root_hint;
+
+        int moves[64], count;
+        order_moves(mask, player, ply, hint, moves, count, depth >= 3);
+
+        int alpha_orig = alpha;
+        int best = -INF, best_move = -1;
+        for (int i = 0; i < count; i++) {
+            int sq = moves[i];
+            Evaluator::State saved = eval_state;
+            uint64_t flips = board.do_move(sq, player);
+            evaluator->update(eval_state, sq, flips, player);
+
+            int score;
+            if (i == 0) {
+                score = -negamax(other(player), depth - 1, -beta, -alpha, ply + 1, false);
+            } else {
+                score = -negamax(other(player), depth - 1, -alpha - 1, -alpha, ply + 1, false);
+                if (score > alpha && score < beta) {
+                    score = -negamax(other(player), depth - 1, -beta, -alpha, ply + 1, false);
+                }
+            }
+
+            board.undo_move(sq, flips, player);
+            eval_state = saved;
+            if (stopped) return 0;
+
+            if (score > best) {
+                best = score;
+                best_move = sq;
+                if (ply == 0) root_best = sq;
+            }
+            if (score > alpha) alpha = score;
+            if (alpha >= beta) {
+                record_cutoff(sq, player, ply, depth);
+                break;
+            }
+        }
+
+        int bound = (best <= alpha_orig) ? TranspositionTable::UPPER
+                  : (best >= beta) ? TranspositionTable::LOWER
+                  : TranspositionTable::EXACT;
+        tt->store(key, best_move, depth, best, bound, thread_id);
+        return best;
+    }
+
+public:
+    // shared 為 NULL 時自己配置一張置換表；多個 Engine 可共用同一張
+    explicit Engine(TranspositionTable* shared = NULL) {
+        if (shared) {
+            tt = shared;
+            owns_tt = false;
+        } else {
+            tt = new TranspositionTable();
+            owns_tt = true;
+        }
+        solver = NULL;
+        evaluator = &Evaluator::instance();
+        book = NULL;
+        thread_id = 0;
+        helper = false;
+        stop_flag = NULL;
+        depth_offset = 0;
+        clear();
+    }
+
+    ~Engine() {
+        if (owns_tt) delete tt;
+        delete solver;
+    }
+
+    // 清掉 killer / history，換新對局時呼叫
+    void clear() {
+        for (int i = 0; i < MAX_PLY + 2; i++) {
+            killers[i][0] = killers[i][1] = -1;
+        }
+        memset(history, 0, sizeof(history));
+        nodes = 0;
+        stopped = false;
+    }
+
+    // 在 deadline 之前盡量加深，回傳最後一個完整深度的最佳步
+    SearchResult search(const Game& game, char player, Clock::time_point limit, int max_depth = 60) {
+        bool solve_endgame = true;     // 指定的深度不夠搜到底時不做完美解
+        board = game;
+        evaluator->init_state(eval_state, board.get_pieces('X'), board.get_pieces('O'));
+        deadline = limit;
+        stopped = false;
+        nodes = 0;
+        // 共用置換表時只由主執行緒換代
+        if (thread_id == 0) tt->new_search();
+
+        SearchResult result;
+        uint64_t mask = board.get_move_mask(player);
+        if (mask == 0) {
+            return result;
+        }
+
+        // 至少先給一步合法棋，避免時間太短時沒有結果
+        int first = __builtin_ctzll(mask);
+        result.row = first / 8;
+        result.col = first % 8;
+
+        // 開局庫有這個局面就直接下，不必搜尋
+        BookMove hit;
+        if (book && !helper && book->best_move(board, player, hit) && ((mask >> hit.move) & 1)) {
+            result.row = hit.move / 8;
+            result.col = hit.move % 8;
+            result.score = hit.score * DISC;
+            return result;
+        }
+
+        int empties = 64 - Bitboard::popcount(board.get_pieces('X') | board.get_pieces('O'));
+        if (max_depth >= empties) {
+            max_depth = empties;
+        } else {
+            solve_endgame = false;
+        }
+
+        // 殘局由主執行緒直接解到底；來不及解完才退回一般搜尋
+        if (solve_endgame && empties <= ENDGAME_EMPTIES && !helper) {
+            if (!solver) solver = new EndgameSolver(8);
+            solver->set_stop_flag(stop_flag);
+            EndgameResult exact = solver->solve(board.get_pieces(player), board.get_pieces(other(player)),
+                                                -64, 64, deadline);
+            nodes += exact.nodes;
+            if (!exact.aborted && exact.move >= 0) {
+                result.row = exact.move / 8;
+                result.col = exact.move % 8;
+                result.score = exact.score * DISC;
+                result.depth = empties;
+                result.nodes = nodes;
+                return result;
+            }
+        }
+
+        root_hint = -1;
+        for (int depth = 1 + depth_offset; depth <= max_depth; depth++) {
+            root_best = -1;
+            int score = negamax(player, depth, -INF, INF, 0, false);
+            if (stopped) break;
+
+            if (root_best >= 0) {
+                result.row = root_best / 8;
+                result.col = root_best % 8;
+            }
+            result.score = score;
+            result.depth = depth;
+            root_hint = root_best;
+        }
+
+        result.nodes = nodes;
+        return result;
+    }
+
+    // 以毫秒指定每步思考時間
+    SearchResult search_for(const Game& game, char player, int millis, int max_depth = 60) {
+        return search(game, player, Clock::now() + std::chrono::milliseconds(millis), max_depth);
+    }
+
+    // 對手思考時替對手搜同一個局面：對手的每個回應都是這棵樹的子節點。
+    // alpha-beta 不留下整棵樹，留下的是置換表（殘局是完美解的表）裡的節點；
+    // 對手下完後 search() 從那個子節點開始，前幾輪迭代大多直接命中。
+    // 下一次 search() 換代後，沒被下到的回應底下的舊表項會先被覆蓋。
+    // 搜到 stop 被設定或 limit 為止，回傳預料對手會下的那一步。
+    SearchResult ponder(const Game& game, char opponent, const std::atomic<bool>* stop, Clock::time_point limit) {
+        const std::atomic<bool>* saved = stop_flag;
+        stop_flag = stop;
+        SearchResult predicted = search(game, opponent, limit);
+        stop_flag = saved;
+        return predicted;
+    }
+
+    unsigned long long get_nodes() const { return nodes; }
+    TranspositionTable& get_table() { return *tt; }
+    // 預設 id 不為 0 的是輔助執行緒；各自搜不同局面時再用 set_helper(false) 改回來
+    void set_thread_id(int id) {
+        thread_id = id;
+        helper = (id != 0);
+    }
+    void set_helper(bool h) { helper = h; }
+    void set_stop_flag(const std::atomic<bool>* flag) { stop_flag = flag; }
+    void set_depth_offset(int offset) { depth_offset = offset; }
+    void set_evaluator(const Evaluator* e) { evaluator = e ? e : &Evaluator::instance(); }
+    void set_book(const OpeningBook* b) { book = b; }
+};
+
+#endif // ENGINE_HPP
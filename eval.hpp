@@ -0,0 +1,398 @@
+#ifndef EVAL_HPP
+#define EVAL_HPP
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "bitboard.hpp"
+
+// 盤面樣式（pattern）評估
+//
+// 每個樣式是一組有序的格子，格子狀態（空 = 0、X = 1、O = 2）組成三進位索引，
+// 查表得到 int16 權重。索引以絕對顏色計算，落子時只需對受影響的樣式加減
+// 3 的次方，不必重算；分數以 X 的視角加總，輪到 O 時取負號。
+// 權重依遊戲階段（棋子數）分成 PHASES 組，每組在記憶體中連續存放。
+class Evaluator {
+public:
+    enum Kind {
+        EDGE_2X = 0,      // 一條邊 + 兩個 X 格
+        CORNER_3X3,
+        CORNER_2X5,
+        DIAG_8,
+        DIAG_7,
+        DIAG_6,
+        DIAG_5,
+        DIAG_4,
+        KIND_COUNT
+    };
+
+    static const int INSTANCES = 34;
+    static const int PHASES = 16;
+    static const int MAX_FEATURES_PER_SQUARE = 8;
+
+    // 每階段最後兩個權重：行動力差、潛在行動力差
+    static const int MOBILITY_WEIGHT = 0;
+    static const int POTENTIAL_WEIGHT = 1;
+    static const int SCALAR_WEIGHTS = 2;
+
+    // 一個局面的所有樣式索引，隨落子增量更新
+    struct State {
+        uint16_t idx[INSTANCES];
+    };
+
+private:
+    struct Feature {
+        uint8_t instance;
+        uint16_t power;
+    };
+
+    int kind_of[INSTANCES];
+    int length_of[INSTANCES];
+    int squares_of[INSTANCES][10];
+    int kind_offset[KIND_COUNT];
+    int kind_size[KIND_COUNT];
+    int phase_size;
+
+    Feature features[64][MAX_FEATURES_PER_SQUARE];
+    int feature_count[64];
+
+    std::vector<int16_t> own_weights;   // 預設權重
+    const int16_t* weights;             // 目前使用的權重（可指向外部 mmap 的檔案）
+
+    static int pow3(int n) {
+        int p = 1;
+        while (n-- > 0) p *= 3;
+        return p;
+    }
+
+    // 對 (row, col) 做對稱變換：bit0 左右翻、bit1 上下翻、bit2 轉置
+    static int transform(int sq, int t) {
+        int r = sq / 8, c = sq % 8;
+        if (t & 4) { int tmp = r; r = c; c = tmp; }
+        if (t & 1) c = 7 - c;
+        if (t & 2) r = 7 - r;
+        return r * 8 + c;
+    }
+
+    void add_instances(Kind kind, const int* base, int length, const int* transforms, int count, int& next) {
+        for (int i = 0; i < count; i++) {
+            kind_of[next] = kind;
+            length_of[next] = length;
+            for (int j = 0; j < length; j++) {
+                squares_of[next][j] = transform(base[j], transforms[i]);
+            }
+            next++;
+        }
+    }
+
+    void build_patterns() {
+        int next = 0;
+
+        static const int edge_2x[10] = {0, 1, 2, 3, 4, 5, 6, 7, 9, 14};
+        static const int edge_t[4] = {0, 2, 4, 5};
+        add_instances(EDGE_2X, edge_2x, 10, edge_t, 4, next);
+
+        static const int corner_3x3[9] = {0, 1, 2, 8, 9, 10, 16, 17, 18};
+        static const int corner_t[4] = {0, 1, 2, 3};
+        add_instances(CORNER_3X3, corner_3x3, 9, corner_t, 4, next);
+
+        static const int corner_2x5[10] = {0, 1, 2, 3, 4, 8, 9, 10, 11, 12};
+        static const int corner_2x5_t[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+        add_instances(CORNER_2X5, corner_2x5, 10, corner_2x5_t, 8, next);
+
+        static const int diag_8[8] = {0, 9, 18, 27, 36, 45, 54, 63};
+        static const int diag_8_t[2] = {0, 1};
+        add_instances(DIAG_8, diag_8, 8, diag_8_t, 2, next);
+
+        // 主對角線旁的短斜線：(r, r + k)，再以轉置、左右翻產生另外三條
+        static const int diag_t[4] = {0, 4, 1, 5};
+        for (int k = 1; k <= 4; k++) {
+            int base[8], length = 8 - k;
+            for (int r = 0; r < length; r++) base[r] = r * 8 + r + k;
+            add_instances((Kind)(DIAG_8 + k), base, length, diag_t, 4, next);
+        }
+
+        int offset = 0;
+        for (int k = 0; k < KIND_COUNT; k++) {
+            for (int i = 0; i < INSTANCES; i++) {
+                if (kind_of[i] == k) {
+                    kind_size[k] = pow3(length_of[i]);
+                    break;
+                }
+            }
+            kind_offset[k] = offset;
+            offset += kind_size[k];
+        }
+        phase_size = offset + SCALAR_WEIGHTS;
+
+        memset(feature_count, 0, sizeof(feature_count));
+        for (int i = 0; i < INSTANCES; i++) {
+            for (int j = 0; j < length_of[i]; j++) {
+                int sq = squares_of[i][j];
+                Feature& f = features[sq][feature_count[sq]++];
+                f.instance = (uint8_t)i;
+                f.power = (uint16_t)pow3(j);
+            }
+        }
+    }
+
+    // 預設權重：把原本 Engine 的位置表、X/C 格規則、行動力與
+    // 殘局棋子數換算成樣式權重，直到有訓練好的權重檔為止
+    void build_default_weights() {
+        static const int square_value[64] = {
+            100, -25,  10,   5,   5,  10, -25, 100,
+            -25, -50,  -5,  -5,  -5,  -5, -50, -25,
+             10,  -5,   2,   1,   1,   2,  -5,  10,
+              5,  -5,   1,   0,   0,   1,  -5,   5,
+              5,  -5,   1,   0,   0,   1,  -5,   5,
+             10,  -5,   2,   1,   1,   2,  -5,  10,
+            -25, -50,  -5,  -5,  -5,  -5, -50, -25,
+            100, -25,  10,   5,   5,  10, -25, 100,
+        };
+
+        // 每格被幾個樣式覆蓋，權重平均分給這些樣式
+        int cover[64];
+        for (int sq = 0; sq < 64; sq++) cover[sq] = feature_count[sq];
+
+        own_weights.assign((size_t)phase_size * PHASES, 0);
+        for (int phase = 0; phase < PHASES; phase++) {
+            int16_t* w = &own_weights[(size_t)phase * phase_size];
+            int disc_weight = (phase >= 11) ? (phase - 10) : 0;
+
+            for (int k = 0; k < KIND_COUNT; k++) {
+                int inst = 0;
+                while (kind_of[inst] != k) inst++;
+                int length = length_of[inst];
+
+                for (int index = 0; index < kind_size[k]; index++) {
+                    int digits[10];
+                    for (int j = 0, x = index; j < length; j++, x /= 3) digits[j] = x % 3;
+
+                    int total = 0;
+                    for (int j = 0; j < length; j++) {
+                        if (digits[j] == 0) continue;
+                        int sq = squares_of[inst][j];
+                        int value = square_value[sq];
+
+                        // X/C 格：相鄰的角已經有子就不再是負擔
+                        int corner = nearest_corner(sq);
+                        if (value < 0 && corner >= 0) {
+                            for (int m = 0; m < length; m++) {
+                                if (squares_of[inst][m] == corner && digits[m] != 0) {
+                                    value = 5;
+                                    break;
+                                }
+                            }
+                        }
+
+                        value += disc_weight;
+                        int sign = (digits[j] == 1) ? 1 : -1;
+                        total += sign * value * 8 / cover[sq];
+                    }
+                    w[kind_offset[k] + index] = (int16_t)total;
+                }
+            }
+
+            w[phase_size - SCALAR_WEIGHTS + MOBILITY_WEIGHT] = (int16_t)(60 - phase * 2);
+            w[phase_size - SCALAR_WEIGHTS + POTENTIAL_WEIGHT] = (int16_t)(phase < 12 ? 15 : 5);
+        }
+        weights = &own_weights[0];
+    }
+
+    // X/C 格相鄰的角；其他格回傳 -1
+    static int nearest_corner(int sq) {
+        int r = sq / 8, c = sq % 8;
+        int cr = (r < 4) ? 0 : 7, cc = (c < 4) ? 0 : 7;
+        int dr = r > cr ? r - cr : cr - r;
+        int dc = c > cc ? c - cc : cc - c;
+        if (dr <= 1 && dc <= 1 && (dr + dc) > 0) return cr * 8 + cc;
+        return -1;
+    }
+
+
+public:
+    Evaluator() {
+        build_patterns();
+        build_default_weights();
+    }
+
+    // 全程共用的預設評估器（權重只讀，可跨執行緒共用）
+    static Evaluator& instance() {
+        static Evaluator evaluator;
+        return evaluator;
+    }
+
+    static int phase_of(uint64_t black, uint64_t white) {
+        int phase = (Bitboard::popcount(black | white) - 4) / 4;
+        if (phase < 0) phase = 0;
+        if (phase >= PHASES) phase = PHASES - 1;
+        return phase;
+    }
+
+    // 從頭計算所有樣式索引
+    void init_state(State& st, uint64_t black, uint64_t white) const {
+        for (int i = 0; i < INSTANCES; i++) {
+            int index = 0;
+            for (int j = length_of[i] - 1; j >= 0; j--) {
+                int sq = squares_of[i][j];
+                int digit = (black >> sq & 1) ? 1 : ((white >> sq & 1) ? 2 : 0);
+                index = index * 3 + digit;
+            }
+            st.idx[i] = (uint16_t)index;
+        }
+    }
+
+    // player 在 sq 落子並翻轉 flips 後的增量更新
+    void update(State& st, int sq, uint64_t flips, char player) const {
+        int placed = (player == 'X') ? 1 : 2;
+        int flip_delta = (player == 'X') ? -1 : 1;   // O(2) -> X(1) 或 X(1) -> O(2)
+
+        for (int k = 0; k < feature_count[sq]; k++) {
+            const Feature& f = features[sq][k];
+            st.idx[f.instance] = (uint16_t)(st.idx[f.instance] + placed * f.power);
+        }
+        while (flips) {
+            int s = Bitboard::pop_lsb(flips);
+            for (int k = 0; k < feature_count[s]; k++) {
+                const Feature& f = features[s][k];
+                st.idx[f.instance] = (uint16_t)(st.idx[f.instance] + flip_delta * f.power);
+            }
+        }
+    }
+
+    // 以 player 的視角回傳分數（單位為 1/100 顆棋子）
+    int evaluate(const State& st, uint64_t black, uint64_t white, char player) const {
+        const int16_t* w = weights + (size_t)phase_of(black, white) * phase_size;
+
+        int sum = 0;
+        for (int i = 0; i < INSTANCES; i++) {
+            sum += w[kind_offset[kind_of[i]] + st.idx[i]];
+        }
+
+        const int16_t* scalar = w + phase_size - SCALAR_WEIGHTS;
+        int mobility = Bitboard::popcount(Bitboard::get_moves(black, white))
+                     - Bitboard::popcount(Bitboard::get_moves(white, black));
+        int potential = Bitboard::popcount(Bitboard::get_frontier_empties(white, black))
+                      - Bitboard::popcount(Bitboard::get_frontier_empties(black, white));
+        sum += scalar[MOBILITY_WEIGHT] * mobility + scalar[POTENTIAL_WEIGHT] * potential;
+
+        return (player == 'X') ? sum : -sum;
+    }
+
+    // 不用增量狀態，直接從盤面評估（速度較慢，給偶爾呼叫的地方用）
+    int evaluate(uint64_t black, uint64_t white, char player) const {
+        State st;
+        init_state(st, black, white);
+        return evaluate(st, black, white, player);
+    }
+
+    // 改用外部的權重區塊（大小需為 weight_count()）
+    void set_weights(const int16_t* external) {
+        weights = external ? external : &own_weights[0];
+    }
+
+    const int16_t* get_weights() const { return weights; }
+    size_t weight_count() const { return (size_t)phase_size * PHASES; }
+    int get_phase_size() const { return phase_size; }
+    int get_kind_offset(int kind) const { return kind_offset[kind]; }
+    int get_kind(int instance) const { return kind_of[instance]; }
+};
+
+// 權重檔格式（little-endian，直接 mmap 使用）：
+//
+//   WeightHeader
+//   int16_t[phases * phase_size]   與 Evaluator 內部的排列相同
+//
+// 由 trainer 產生；樣式定義改變時 phase_size 會不同，舊檔案就載入失敗。
+struct WeightHeader {
+    char magic[8];          // "RVWGHT01"
+    uint32_t phase_size;
+    uint32_t phases;
+};
+
+class WeightFile {
+private:
+    int fd;
+    void* mapping;
+    size_t mapped_size;
+    const int16_t* data;
+
+    WeightFile(const WeightFile&);
+    WeightFile& operator=(const WeightFile&);
+
+public:
+    static const char* magic() { return "RVWGHT01"; }
+
+    WeightFile() : fd(-1), mapping(NULL), mapped_size(0), data(NULL) {}
+
+    ~WeightFile() {
+        close();
+    }
+
+    // 大小與 evaluator 的樣式不合時回傳 false
+    bool open(const std::string& path, const Evaluator& evaluator) {
+        close();
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        size_t expected = sizeof(WeightHeader) + evaluator.weight_count() * sizeof(int16_t);
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size != expected) {
+            close();
+            return false;
+        }
+        mapped_size = expected;
+        mapping = mmap(NULL, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = NULL;
+            close();
+            return false;
+        }
+
+        const WeightHeader* header = static_cast<const WeightHeader*>(mapping);
+        if (memcmp(header->magic, magic(), 8) != 0 ||
+            header->phase_size != (uint32_t)evaluator.get_phase_size() ||
+            header->phases != (uint32_t)Evaluator::PHASES) {
+            close();
+            return false;
+        }
+        // 每次評估都會查表，先全部讀進來
+        madvise(mapping, mapped_size, MADV_WILLNEED);
+        data = reinterpret_cast<const int16_t*>(header + 1);
+        return true;
+    }
+
+    void close() {
+        if (mapping) munmap(mapping, mapped_size);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        mapping = NULL;
+        mapped_size = 0;
+        data = NULL;
+    }
+
+    bool is_open() const { return data != NULL; }
+    const int16_t* weights() const { return data; }
+
+    // weights 的大小需為 evaluator.weight_count()
+    static bool save(const std::string& path, const Evaluator& evaluator, const int16_t* weights) {
+        FILE* out = fopen(path.c_str(), "wb");
+        if (!out) return false;
+        WeightHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, magic(), 8);
+        header.phase_size = (uint32_t)evaluator.get_phase_size();
+        header.phases = Evaluator::PHASES;
+        bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                  fwrite(weights, sizeof(int16_t), evaluator.weight_count(), out) == evaluator.weight_count();
+        return fclose(out) == 0 && ok;
+    }
+};
+
+#endif // EVAL_HPP
@@ -0,0 +1,181 @@
+#ifndef FRAME_HPP
+#define FRAME_HPP
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include "protocol.hpp"
+
+// 不擁有資料的字串片段（C++11 沒有 string_view）
+struct Slice {
+    const char* data;
+    size_t size;
+
+    Slice() : data(NULL), size(0) {}
+    Slice(const char* d, size_t n) : data(d), size(n) {}
+
+    bool empty() const { return size == 0; }
+    char operator[](size_t i) const { return data[i]; }
+    std::string str() const { return std::string(data, size); }
+
+    bool equals(const char* s) const {
+        size_t n = strlen(s);
+        return n == size && memcmp(data, s, n) == 0;
+    }
+
+    // 切出下一個以 delim 分隔的欄位並把自己往後移；已經切完時回傳 false
+    bool next_token(char delim, Slice& token) {
+        if (data == NULL) return false;
+        const char* p = static_cast<const char*>(memchr(data, delim, size));
+        if (!p) {
+            token = *this;
+            data = NULL;
+            size = 0;
+            return true;
+        }
+        token = Slice(data, p - data);
+        size -= (p - data) + 1;
+        data = p + 1;
+        return true;
+    }
+};
+
+// 每條連線一個的環狀接收緩衝
+//
+// recv 直接寫進空白區；取出完整訊息時只回傳指向緩衝內部的 Slice，
+// 只有訊息剛好跨過緩衝尾端時才複製到 scratch 接成連續的一段。
+// 回傳的 Slice 在下一次 read_from() 或下一則跨尾端的訊息之前有效。
+class FrameReader {
+public:
+    enum ReadResult { READ_AGAIN, READ_FULL, READ_EOF, READ_ERROR };
+
+private:
+    char* buf;
+    size_t capacity;        // 2 的次方
+    size_t head;            // 讀取位置（只增不減，用 & 取得實際位置）
+    size_t tail;            // 寫入位置
+    std::string scratch;    // 跨尾端的訊息接在這裡，容量會重複使用
+
+    FrameReader(const FrameReader&);
+    FrameReader& operator=(const FrameReader&);
+
+    size_t wrap(size_t i) const { return i & (capacity - 1); }
+    uint8_t at(size_t offset) const { return (uint8_t)buf[wrap(head + offset)]; }
+
+    // 從讀取位置往後 offset 起、長度 n 的連續片段
+    Slice view(size_t offset, size_t n) {
+        size_t start = wrap(head + offset);
+        if (start + n <= capacity) return Slice(buf + start, n);
+        size_t first = capacity - start;
+        scratch.assign(buf + start, first);
+        scratch.append(buf, n - first);
+        return Slice(scratch.data(), n);
+    }
+
+    void consume(size_t n) {
+        head += n;
+        if (head == tail) head = tail = 0;   // 清空時回到開頭，減少跨尾端
+    }
+
+public:
+    explicit FrameReader(size_t min_capacity = 4096) : head(0), tail(0) {
+        capacity = 1;
+        while (capacity < min_capacity) capacity <<= 1;
+        buf = new char[capacity];
+    }
+
+    ~FrameReader() {
+        delete[] buf;
+    }
+
+    void clear() { head = tail = 0; }
+
+    size_t size() const { return tail - head; }
+    bool empty() const { return head == tail; }
+    bool full() const { return size() == capacity; }
+
+    // 目前可以直接寫入的連續空白區
+    char* write_space(size_t& length) {
+        size_t start = wrap(tail);
+        size_t free = capacity - size();
+        length = (free < capacity - start) ? free : capacity - start;
+        return buf + start;
+    }
+
+    void commit(size_t n) { tail += n; }
+
+    // 從 fd 讀到沒有資料（READ_AGAIN）或緩衝滿了（READ_FULL）為止
+    ReadResult read_from(int fd, int flags = 0) {
+        while (true) {
+            size_t length;
+            char* p = write_space(length);
+            if (length == 0) return READ_FULL;
+            ssize_t n = recv(fd, p, length, flags);
+            if (n > 0) {
+                commit(n);
+            } else if (n == 0) {
+                return READ_EOF;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return READ_AGAIN;
+            } else {
+                return READ_ERROR;
+            }
+        }
+    }
+
+    // 取出一行（不含 \n 與結尾的 \r）
+    bool next_line(Slice& line) {
+        size_t n = size();
+        size_t start = wrap(head);
+        size_t first = (n < capacity - start) ? n : capacity - start;
+
+        size_t pos;
+        const char* p = static_cast<const char*>(memchr(buf + start, '\n', first));
+        if (p) {
+            pos = p - (buf + start);
+        } else {
+            if (n == first) return false;
+            p = static_cast<const char*>(memchr(buf, '\n', n - first));
+            if (!p) return false;
+            pos = first + (p - buf);
+        }
+
+        line = view(0, pos);
+        consume(pos + 1);
+        if (line.size > 0 && line.data[line.size - 1] == '\r') line.size--;
+        return true;
+    }
+
+    // 剩下的資料整段當成一則訊息（舊版客戶端送名字和棋步時不加換行）
+    bool take_rest(Slice& rest) {
+        if (empty()) return false;
+        rest = view(0, size());
+        consume(size());
+        if (rest.size > 0 && rest.data[rest.size - 1] == '\r') rest.size--;
+        return true;
+    }
+
+    // 二進位訊息：1 = 取出一則、0 = 資料還不夠、-1 = 格式錯誤
+    int next_frame(uint8_t& type, Slice& payload) {
+        if (size() < Protocol::HEADER_SIZE) return 0;
+        size_t length = at(1) | ((size_t)at(2) << 8);
+        if (length > Protocol::MAX_PAYLOAD) return -1;
+        if (size() < Protocol::HEADER_SIZE + length) return 0;
+
+        type = at(0);
+        payload = view(Protocol::HEADER_SIZE, length);
+        consume(Protocol::HEADER_SIZE + length);
+        return 1;
+    }
+
+    // 看第一個位元組但不取走（協定協商用）；沒有資料時回傳 -1
+    int peek() const { return empty() ? -1 : at(0); }
+    void skip(size_t n) { consume(n < size() ? n : size()); }
+};
+
+#endif // FRAME_HPP
@@ -4,181 +4,206 @@
 #include <string>
 #include <vector>
 #include <utility>
+#include <cstdint>
+#include "bitboard.hpp"
+#include "zobrist.hpp"
 
 class Game {
 private:
-    char board[8][8];
+    uint64_t black;   // X
+    uint64_t white;   // O
     char current_player;
     int black_count;
     int white_count;
-    
-    const int dx[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
-    const int dy[8] = {0, 0, -1, 1, -1, 1, -1, 1};
-    
+    uint64_t hash;    // 盤面的 Zobrist 雜湊，隨 make_move/do_move/undo_move 增量更新
+
     bool is_valid_pos(int row, int col) const {
         return row >= 0 && row < 8 && col >= 0 && col < 8;
     }
-    
-    bool check_direction(int row, int col, int dir, char player) {
-        char opponent = (player == 'X') ? 'O' : 'X';
-        int r = row + dx[dir];
-        int c = col + dy[dir];
-        
-        if (!is_valid_pos(r, c) || board[r][c] != opponent) {
-            return false;
-        }
-        
-        r += dx[dir];
-        c += dy[dir];
-        
-        while (is_valid_pos(r, c)) {
-            if (board[r][c] == '*') {
-                return false;
-            }
-            if (board[r][c] == player) {
-                return true;
-            }
-            r += dx[dir];
-            c += dy[dir];
-        }
-        
-        return false;
-    }
-    
-    void flip_direction(int row, int col, int dir, char player) {
-        char opponent = (player == 'X') ? 'O' : 'X';
-        int r = row + dx[dir];
-        int c = col + dy[dir];
-        
-        while (is_valid_pos(r, c) && board[r][c] == opponent) {
-            board[r][c] = player;
-            r += dx[dir];
-            c += dy[dir];
-        }
+
+    uint64_t& pieces_of(char player) {
+        return (player == 'X') ? black : white;
+    }
+
+    uint64_t& pieces_against(char player) {
+        return (player == 'X') ? white : black;
     }
-    
+
     void count_pieces() {
-        black_count = 0;
-        white_count = 0;
-        for (int i = 0; i < 8; i++) {
-            for (int j = 0; j < 8; j++) {
-                if (board[i][j] == 'X') black_count++;
-                else if (board[i][j] == 'O') white_count++;
-            }
-        }
+        black_count = Bitboard::popcount(black);
+        white_count = Bitboard::popcount(white);
     }
 
 public:
     Game() {
-        for (int i = 0; i < 8; i++) {
-            for (int j = 0; j < 8; j++) {
-                board[i][j] = '*';
-            }
-        }
-        
-        board[3][3] = 'X';
-        board[3][4] = 'O';
-        board[4][3] = 'O';
-        board[4][4] = 'X';
-        
+        black = Bitboard::square(3, 3) | Bitboard::square(4, 4);
+        white = Bitboard::square(3, 4) | Bitboard::square(4, 3);
+
         current_player = 'X';
         black_count = 2;
         white_count = 2;
+        hash = Zobrist::hash_board(black, white);
     }
-    
+
+    // 回傳 player 所有合法落子位置的位元遮罩
+    uint64_t get_move_mask(char player) const {
+        if (player == 'X') return Bitboard::get_moves(black, white);
+        return Bitboard::get_moves(white, black);
+    }
+
+    uint64_t get_pieces(char player) const {
+        return (player == 'X') ? black : white;
+    }
+
+    // 輪到 player 下時的局面雜湊
+    uint64_t get_hash(char player) const {
+        return (player == 'X') ? hash : (hash ^ Zobrist::side_key());
+    }
+
     bool is_valid_move(int row, int col, char player) {
-        if (!is_valid_pos(row, col) || board[row][col] != '*') {
+        if (!is_valid_pos(row, col)) {
             return false;
         }
-        
-        for (int dir = 0; dir < 8; dir++) {
-            if (check_direction(row, col, dir, player)) {
-                return true;
-            }
-        }
-        
-        return false;
+        return (get_move_mask(player) & Bitboard::square(row, col)) != 0;
     }
-    
+
     bool make_move(int row, int col, char player) {
-        if (!is_valid_move(row, col, player)) {
+        if (!is_valid_pos(row, col)) {
+            return false;
+        }
+
+        uint64_t& own = pieces_of(player);
+        uint64_t& opp = pieces_against(player);
+        uint64_t sq = Bitboard::square(row, col);
+        if ((own | opp) & sq) {
             return false;
         }
-        
-        board[row][col] = player;
-        
-        for (int dir = 0; dir < 8; dir++) {
-            if (check_direction(row, col, dir, player)) {
-                flip_direction(row, col, dir, player);
-            }
+
+        uint64_t flips = Bitboard::get_flips(own, opp, row * 8 + col);
+        if (flips == 0) {
+            return false;
         }
-        
+
+        own |= sq | flips;
+        opp &= ~flips;
+        hash ^= Zobrist::piece_key(player == 'X' ? 0 : 1, row * 8 + col) ^ Zobrist::flips_key(flips);
+
         count_pieces();
         current_player = (player == 'X') ? 'O' : 'X';
         return true;
     }
-    
+
+    // 搜尋用的 make/unmake：不檢查合法性，回傳被翻轉的棋子供 undo_move 還原
+    uint64_t do_move(int sq, char player) {
+        uint64_t& own = pieces_of(player);
+        uint64_t& opp = pieces_against(player);
+        uint64_t flips = Bitboard::get_flips(own, opp, sq);
+
+        own |= (1ULL << sq) | flips;
+        opp &= ~flips;
+        hash ^= Zobrist::piece_key(player == 'X' ? 0 : 1, sq) ^ Zobrist::flips_key(flips);
+
+        int n = Bitboard::popcount(flips);
+        if (player == 'X') {
+            black_count += n + 1;
+            white_count -= n;
+        } else {
+            white_count += n + 1;
+            black_count -= n;
+        }
+        current_player = (player == 'X') ? 'O' : 'X';
+        return flips;
+    }
+
+    void undo_move(int sq, uint64_t flips, char player) {
+        uint64_t& own = pieces_of(player);
+        uint64_t& opp = pieces_against(player);
+
+        own &= ~((1ULL << sq) | flips);
+        opp |= flips;
+        hash ^= Zobrist::piece_key(player == 'X' ? 0 : 1, sq) ^ Zobrist::flips_key(flips);
+
+        int n = Bitboard::popcount(flips);
+        if (player == 'X') {
+            black_count -= n + 1;
+            white_count += n;
+        } else {
+            white_count -= n + 1;
+            black_count += n;
+        }
+        current_player = player;
+    }
+
     bool parse_move(const std::string& move, int& row, int& col) {
-        if (move.length() != 2) return false;
-        
+        return parse_move(move.data(), move.length(), row, col);
+    }
+
+    bool parse_move(const char* move, size_t length, int& row, int& col) const {
+        if (length != 2) return false;
+
         col = move[0] - 'a';
         row = 8 - (move[1] - '0');
-        
+
         return is_valid_pos(row, col);
     }
-    
+
     std::vector<std::pair<int, int>> get_valid_moves(char player) {
         std::vector<std::pair<int, int>> moves;
-        for (int i = 0; i < 8; i++) {
-            for (int j = 0; j < 8; j++) {
-                if (is_valid_move(i, j, player)) {
-                    moves.push_back(std::make_pair(i, j));
-                }
-            }
+        uint64_t mask = get_move_mask(player);
+        while (mask) {
+            int sq = Bitboard::pop_lsb(mask);
+            moves.push_back(std::make_pair(sq / 8, sq % 8));
         }
         return moves;
     }
-    
+
     bool has_valid_moves(char player) {
-        return !get_valid_moves(player).empty();
+        return get_move_mask(player) != 0;
     }
-    
+
     bool is_game_over() {
         return !has_valid_moves('X') && !has_valid_moves('O');
     }
-    
+
     std::string get_board_state() {
-        std::string state;
-        for (int i = 0; i < 8; i++) {
-            for (int j = 0; j < 8; j++) {
-                state += board[i][j];
-            }
+        std::string state(64, '*');
+        for (int i = 0; i < 64; i++) {
+            if (black >> i & 1) state[i] = 'X';
+            else if (white >> i & 1) state[i] = 'O';
         }
         return state;
     }
-    
+
     void set_board_state(const std::string& state) {
-        if (state.length() != 64) return;
-        
-        int idx = 0;
-        for (int i = 0; i < 8; i++) {
-            for (int j = 0; j < 8; j++) {
-                board[i][j] = state[idx++];
-            }
+        set_board_state(state.data(), state.length());
+    }
+
+    void set_board_state(const char* state, size_t length) {
+        if (length != 64) return;
+
+        black = 0;
+        white = 0;
+        for (int i = 0; i < 64; i++) {
+            if (state[i] == 'X') black |= 1ULL << i;
+            else if (state[i] == 'O') white |= 1ULL << i;
         }
+        hash = Zobrist::hash_board(black, white);
         count_pieces();
     }
-    
+
     char get_piece(int row, int col) const {
         if (!is_valid_pos(row, col)) return '*';
-        return board[row][col];
+        uint64_t sq = Bitboard::square(row, col);
+        if (black & sq) return 'X';
+        if (white & sq) return 'O';
+        return '*';
     }
-    
+
     char get_current_player() const { return current_player; }
     void set_current_player(char player) { current_player = player; }
     int get_black_count() const { return black_count; }
     int get_white_count() const { return white_count; }
-    
+
     std::string get_result() {
         count_pieces();
         if (black_count > white_count) {
@@ -191,4 +216,4 @@ public:
     }
 };
 
-#endif // GAME_HPP
\ No newline at end of file
+#endif // GAME_HPP
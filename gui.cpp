@@ -28,7 +28,11 @@ struct AppData {
     std::string my_name;
     std::string opponent_name;
     
-    guint network_timer_id;
+    guint network_watch_id;
+    gint64 move_sent_at;       // 送出棋步的時間（微秒），用來量測來回延遲
+    gint64 latency_total;
+    int latency_count;
+    bool use_text_protocol;    // --text：用舊版文字協定連線到舊伺服器
 };
 
 AppData app_data;
@@ -118,97 +122,185 @@ void enable_board(bool enable) {
     }
 }
 
-// 處理網路訊息
-gboolean check_network_messages(gpointer user_data) {
-    if (!app_data.network->is_connected()) {
-        return TRUE;
-    }
+// 自己的棋步被伺服器確認時，記錄從點擊到確認的延遲
+void record_move_latency() {
+    if (app_data.move_sent_at == 0) return;
+    gint64 elapsed = g_get_monotonic_time() - app_data.move_sent_at;
+    app_data.move_sent_at = 0;
+    app_data.latency_total += elapsed;
+    app_data.latency_count++;
+    std::cout << "[LATENCY] move confirmed in " << elapsed / 1000.0 << " ms (avg "
+              << app_data.latency_total / 1000.0 / app_data.latency_count << " ms over "
+              << app_data.latency_count << " moves)" << std::endl;
+}
+
+// 輪到 piece 下棋時更新介面
+void set_turn(char piece) {
+    app_data.is_my_turn = (piece == app_data.my_piece);
+    update_board();
+    update_info();
+    enable_board(app_data.is_my_turn);
+}
+
+void show_game_over(const std::string& result) {
+    GtkWidget* dialog = gtk_message_dialog_new(
+        GTK_WINDOW(app_data.window),
+        GTK_DIALOG_MODAL,
+        GTK_MESSAGE_INFO,
+        GTK_BUTTONS_OK,
+        "Game Over!\n%s\n\nX: %d\nO: %d",
+        result.c_str(),
+        app_data.game->get_black_count(),
+        app_data.game->get_white_count()
+    );
+    gtk_dialog_run(GTK_DIALOG(dialog));
+    gtk_widget_destroy(dialog);
     
-    std::string msg = app_data.network->receive_message();
-    if (msg.empty()) {
-        return TRUE;
+    enable_board(false);
+}
+
+// 二進位協定：伺服器只送棋步，由本地的 Game 套用
+// payload 指向接收緩衝內部，只在這次呼叫中有效
+void handle_frame(uint8_t type, const Slice& p) {
+    if (type == Protocol::S_WAIT) {
+        gtk_label_set_text(GTK_LABEL(app_data.status_label), "Waiting for opponent...");
     }
-    
-    // 可能一次收到多個訊息，用換行符分割
-    std::stringstream ss(msg);
-    std::string line;
-    
-    while (std::getline(ss, line)) {
-        if (line.empty()) continue;
+    else if (type == Protocol::S_START && p.size >= 1) {
+        app_data.my_piece = p[0];
+        app_data.opponent_name = Slice(p.data + 1, p.size - 1).str();
+        app_data.network->set_opponent_name(app_data.opponent_name);
+        app_data.network->set_my_piece(app_data.my_piece);
+        *app_data.game = Game();
         
-        // 移除可能的 \r
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
-        
-        std::vector<std::string> parts;
-        std::string cmd = app_data.network->parse_message(line, parts);
+        gtk_label_set_text(GTK_LABEL(app_data.status_label), "Game started!");
+        set_turn('X');
+    }
+    else if (type == Protocol::S_MOVE && p.size == 3) {
+        int sq = (uint8_t)p[0];
+        char mover = p[1];
+        int row = sq / 8, col = sq % 8;
         
-        if (cmd == "WAIT") {
-            gtk_label_set_text(GTK_LABEL(app_data.status_label), "Waiting for opponent...");
-        }
-        else if (cmd == "START" && parts.size() >= 3) {
-            app_data.opponent_name = parts[1];
-            app_data.my_piece = parts[2][0];
-            app_data.network->set_opponent_name(app_data.opponent_name);
-            app_data.network->set_my_piece(app_data.my_piece);
-            
-            // 不要用對話框，直接更新介面
-            gtk_label_set_text(GTK_LABEL(app_data.status_label), "Game started!");
-            update_info();
-            update_board();
-        }
-        else if (cmd == "YOUR_TURN" && parts.size() >= 2) {
-            app_data.game->set_board_state(parts[1]);
-            app_data.is_my_turn = true;
-            
-            update_board();
-            update_info();
-            enable_board(true);
+        // 本地盤面不同步時向伺服器要完整盤面
+        if (sq >= 64 || !app_data.game->is_valid_move(row, col, mover)) {
+            app_data.network->request_resync();
+            return;
         }
-        else if (cmd == "OPPONENT_TURN" && parts.size() >= 2) {
-            app_data.game->set_board_state(parts[1]);
-            app_data.is_my_turn = false;
-            
-            update_board();
-            update_info();
-            enable_board(false);
-        }
-        else if (cmd == "MOVE_OK" && parts.size() >= 2) {
-            std::string history = app_data.my_name + ": " + parts[1];
-            add_history(history);
-            
-            app_data.is_my_turn = false;
-            enable_board(false);
-            update_info();
-        }
-        else if (cmd == "INVALID" && parts.size() >= 2) {
-            gtk_label_set_text(GTK_LABEL(app_data.status_label), 
-                ("Invalid move: " + parts[1]).c_str());
-        }
-        else if (cmd == "OPPONENT_DISCONNECT") {
-            gtk_label_set_text(GTK_LABEL(app_data.status_label), "Opponent disconnected. You win!");
-            enable_board(false);
+        app_data.game->make_move(row, col, mover);
+        if (mover == app_data.my_piece) record_move_latency();
+        
+        std::string who = (mover == app_data.my_piece) ? app_data.my_name : app_data.opponent_name;
+        add_history(who + ": " + position_to_string(row, col));
+        set_turn(p[2]);
+    }
+    else if (type == Protocol::S_PASS && p.size == 1) {
+        set_turn(p[0] == 'X' ? 'O' : 'X');
+    }
+    else if (type == Protocol::S_INVALID) {
+        gtk_label_set_text(GTK_LABEL(app_data.status_label), ("Invalid move: " + p.str()).c_str());
+    }
+    else if (type == Protocol::S_SNAPSHOT) {
+        std::string state;
+        char to_move;
+        if (Protocol::decode_snapshot(p.data, p.size, state, to_move)) {
+            app_data.game->set_board_state(state);
+            set_turn(to_move);
         }
-        else if (cmd == "END" && parts.size() >= 3) {
-            app_data.game->set_board_state(parts[2]);
-            update_board();
-            
-            GtkWidget* dialog = gtk_message_dialog_new(
-                GTK_WINDOW(app_data.window),
-                GTK_DIALOG_MODAL,
-                GTK_MESSAGE_INFO,
-                GTK_BUTTONS_OK,
-                "Game Over!\n%s\n\nX: %d\nO: %d",
-                parts[1].c_str(),
-                app_data.game->get_black_count(),
-                app_data.game->get_white_count()
-            );
-            gtk_dialog_run(GTK_DIALOG(dialog));
-            gtk_widget_destroy(dialog);
-            
-            enable_board(false);
+    }
+    else if (type == Protocol::S_OPPONENT_DISCONNECT) {
+        gtk_label_set_text(GTK_LABEL(app_data.status_label), "Opponent disconnected. You win!");
+        enable_board(false);
+    }
+    else if (type == Protocol::S_END) {
+        app_data.is_my_turn = false;
+        update_board();
+        update_info();
+        show_game_over(p.str());
+    }
+}
+
+// 文字協定：CMD:field1:field2，欄位直接在接收緩衝上切，不另外複製
+void handle_line(Slice rest) {
+    Slice cmd, f1, f2;
+    rest.next_token(':', cmd);
+    bool has1 = rest.next_token(':', f1);
+    bool has2 = rest.next_token(':', f2);
+    
+    if (cmd.equals("WAIT")) {
+        gtk_label_set_text(GTK_LABEL(app_data.status_label), "Waiting for opponent...");
+    }
+    else if (cmd.equals("START") && has2 && !f2.empty()) {
+        app_data.opponent_name = f1.str();
+        app_data.my_piece = f2[0];
+        app_data.network->set_opponent_name(app_data.opponent_name);
+        app_data.network->set_my_piece(app_data.my_piece);
+        
+        // 不要用對話框，直接更新介面
+        gtk_label_set_text(GTK_LABEL(app_data.status_label), "Game started!");
+        update_info();
+        update_board();
+    }
+    else if (cmd.equals("YOUR_TURN") && has1) {
+        app_data.game->set_board_state(f1.data, f1.size);
+        app_data.is_my_turn = true;
+        
+        update_board();
+        update_info();
+        enable_board(true);
+    }
+    else if (cmd.equals("OPPONENT_TURN") && has1) {
+        app_data.game->set_board_state(f1.data, f1.size);
+        app_data.is_my_turn = false;
+        
+        update_board();
+        update_info();
+        enable_board(false);
+    }
+    else if (cmd.equals("MOVE_OK") && has1) {
+        record_move_latency();
+        add_history(app_data.my_name + ": " + f1.str());
+        
+        app_data.is_my_turn = false;
+        enable_board(false);
+        update_info();
+    }
+    else if (cmd.equals("INVALID") && has1) {
+        gtk_label_set_text(GTK_LABEL(app_data.status_label), 
+            ("Invalid move: " + f1.str()).c_str());
+    }
+    else if (cmd.equals("OPPONENT_DISCONNECT")) {
+        gtk_label_set_text(GTK_LABEL(app_data.status_label), "Opponent disconnected. You win!");
+        enable_board(false);
+    }
+    else if (cmd.equals("END") && has2) {
+        app_data.game->set_board_state(f2.data, f2.size);
+        update_board();
+        show_game_over(f1.str());
+    }
+}
+
+// 處理網路訊息：socket 可讀時由 GLib main loop 呼叫，閒置時不會喚醒
+gboolean check_network_messages(GIOChannel* source, GIOCondition condition, gpointer user_data) {
+    if (!app_data.network->is_connected()) {
+        app_data.network_watch_id = 0;
+        return FALSE;
+    }
+    
+    // 一次把 socket 讀空，再逐則取出完整訊息；不完整的留在緩衝等下一次
+    app_data.network->receive();
+    
+    if (app_data.network->is_binary()) {
+        uint8_t type;
+        Slice payload;
+        while (app_data.network->next_frame(type, payload) > 0) {
+            handle_frame(type, payload);
         }
+        return TRUE;
+    }
+    
+    Slice line;
+    while (app_data.network->next_line(line)) {
+        if (line.empty()) continue;
+        handle_line(line);
     }
     
     return TRUE;
@@ -227,6 +319,7 @@ void on_board_button_clicked(GtkWidget* widget, gpointer data) {
     }
     
     std::string move = position_to_string(row, col);
+    app_data.move_sent_at = g_get_monotonic_time();
     app_data.network->send_move(move);
 }
 
@@ -246,9 +339,12 @@ void on_connect_clicked(GtkWidget* widget, gpointer data) {
     gtk_widget_set_sensitive(app_data.connect_button, FALSE);
     gtk_button_set_label(GTK_BUTTON(app_data.connect_button), "Connecting...");
     
-    if (app_data.network->connect_to_server(host, port, name)) {
+    if (app_data.network->connect_to_server(host, port, name, !app_data.use_text_protocol)) {
         gtk_label_set_text(GTK_LABEL(app_data.status_label), "Connected to server");
-        app_data.network_timer_id = g_timeout_add(100, check_network_messages, NULL);
+        GIOChannel* channel = g_io_channel_unix_new(app_data.network->get_socket());
+        app_data.network_watch_id = g_io_add_watch(channel, (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR),
+                                                   check_network_messages, NULL);
+        g_io_channel_unref(channel);   // watch 會自己保留一份參考
     } else {
         gtk_label_set_text(GTK_LABEL(app_data.status_label), "Connection failed!");
         gtk_widget_set_sensitive(app_data.connect_button, TRUE);
@@ -257,8 +353,8 @@ void on_connect_clicked(GtkWidget* widget, gpointer data) {
 }
 
 void on_window_destroy(GtkWidget* widget, gpointer data) {
-    if (app_data.network_timer_id > 0) {
-        g_source_remove(app_data.network_timer_id);
+    if (app_data.network_watch_id > 0) {
+        g_source_remove(app_data.network_watch_id);
     }
     gtk_main_quit();
 }
@@ -485,7 +581,11 @@ int main(int argc, char* argv[]) {
     app_data.network = new NetworkClient();
     app_data.is_my_turn = false;
     app_data.my_piece = ' ';
-    app_data.network_timer_id = 0;
+    app_data.network_watch_id = 0;
+    app_data.move_sent_at = 0;
+    app_data.latency_total = 0;
+    app_data.latency_count = 0;
+    app_data.use_text_protocol = (argc >= 2 && std::string(argv[1]) == "--text");
     
     create_ui();
     
@@ -0,0 +1,81 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <cstdint>
+#include <cstring>
+
+// 對數分桶的直方圖，用來算等待時間之類的百分位數
+//
+// 小於 16 的值各佔一格；之後每個 2 的次方區間再平均切成 16 格，
+// 所以回報的百分位數相對誤差不超過 1/16，而且不管記了多少筆都只佔固定 8 KB。
+// 本身不上鎖，多執行緒使用時由呼叫端保護。
+class Histogram {
+private:
+    static const int SUB_BITS = 4;
+    static const int SUB = 1 << SUB_BITS;
+    static const int SLOTS = (64 - SUB_BITS + 1) * SUB;
+
+    uint64_t counts[SLOTS];
+    uint64_t total;
+    uint64_t max_value;
+
+    static int index_of(uint64_t v) {
+        if (v < (uint64_t)SUB) return (int)v;
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - SUB_BITS;
+        return (shift + 1) * SUB + (int)((v >> shift) & (SUB - 1));
+    }
+
+    // 這一格涵蓋的最大值
+    static uint64_t upper_bound(int index) {
+        if (index < SUB) return (uint64_t)index;
+        int shift = index / SUB - 1;
+        uint64_t low = (uint64_t)(SUB + index % SUB) << shift;
+        return low + (((uint64_t)1 << shift) - 1);
+    }
+
+public:
+    Histogram() {
+        clear();
+    }
+
+    void clear() {
+        memset(counts, 0, sizeof(counts));
+        total = 0;
+        max_value = 0;
+    }
+
+    void record(uint64_t v) {
+        counts[index_of(v)]++;
+        total++;
+        if (v > max_value) max_value = v;
+    }
+
+    void merge(const Histogram& other) {
+        for (int i = 0; i < SLOTS; i++) counts[i] += other.counts[i];
+        total += other.total;
+        if (other.max_value > max_value) max_value = other.max_value;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return max_value; }
+
+    // p 介於 0 到 100；回傳該百分位所在格子的上界（不超過實際最大值）
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)(p / 100.0 * total + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > total) rank = total;
+        uint64_t seen = 0;
+        for (int i = 0; i < SLOTS; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                uint64_t v = upper_bound(i);
+                return v < max_value ? v : max_value;
+            }
+        }
+        return max_value;
+    }
+};
+
+#endif // HISTOGRAM_HPP
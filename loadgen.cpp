@@ -0,0 +1,451 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include "game.hpp"
+#include "engine.hpp"
+#include "protocol.hpp"
+#include "frame.hpp"
+#include "histogram.hpp"
+#include "timing_wheel.hpp"
+
+// 壓力測試工具：開 N 條連線，以真正的協定和伺服器對下
+//
+// 每條連線登入後等配對，輪到自己時隨機（或用引擎搜固定深度）挑一步合法棋，
+// 可設定思考時間；一局結束就重新連線再排隊。
+// 統計每秒對局數、每秒步數與每步來回延遲（送出棋步到伺服器確認）的百分位數。
+
+typedef std::chrono::steady_clock Clock;
+
+static uint64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+struct Options {
+    std::string ip;
+    int port;
+    int clients;
+    int threads;
+    double duration;        // 秒
+    int think_ms;
+    int engine_depth;       // 0 = 隨機走
+    bool binary;
+    bool vs_cpu;            // 每條連線各自和伺服器的電腦對手下
+};
+
+// 所有執行緒共用的計數器；延遲直方圖每條執行緒各一份，結束時合併
+struct Totals {
+    std::atomic<unsigned long long> games;
+    std::atomic<unsigned long long> moves;
+    std::atomic<unsigned long long> errors;
+    std::atomic<unsigned long long> disconnects;
+    std::atomic<unsigned long long> connects;
+
+    Totals() : games(0), moves(0), errors(0), disconnects(0), connects(0) {}
+};
+
+struct Client {
+    enum State { IDLE, CONNECTING, WAITING, PLAYING };
+
+    int id;
+    int fd;
+    State state;
+    FrameReader reader;
+    Game game;
+    char piece;
+    char turn;              // 二進位協定自己推算輪到誰
+    uint64_t sent_at;       // 送出棋步的時間（us），0 代表沒有等待中的棋步
+    TimingWheel::Timer timer;
+
+    explicit Client(int i) : id(i), fd(-1), state(IDLE), reader(4096), piece(0), turn('X'), sent_at(0) {
+        timer.owner = this;
+    }
+};
+
+class Worker {
+private:
+    const Options& opt;
+    Totals& totals;
+    std::vector<Client*> clients;
+    Histogram rtt_us;
+    int epoll_fd;
+    TimingWheel wheel;      // 思考時間到了才送出棋步
+    TranspositionTable* table;
+    Engine* engine;
+    std::mt19937 rng;
+    uint64_t stop_at;
+
+    Worker(const Worker&);
+    Worker& operator=(const Worker&);
+
+    static uint64_t ms() { return now_us() / 1000; }
+
+    void start(Client* c) {
+        c->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (c->fd < 0) {
+            totals.errors++;
+            return;
+        }
+        int one = 1;
+        setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(opt.port);
+        inet_pton(AF_INET, opt.ip.c_str(), &address.sin_addr);
+        if (connect(c->fd, (struct sockaddr*)&address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+            close(c->fd);
+            c->fd = -1;
+            totals.errors++;
+            return;
+        }
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = c;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->fd, &ev);
+        c->state = Client::CONNECTING;
+        c->reader.clear();
+        c->game = Game();
+        c->sent_at = 0;
+    }
+
+    void stop(Client* c) {
+        wheel.cancel(&c->timer);
+        if (c->fd >= 0) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+            close(c->fd);
+        }
+        c->fd = -1;
+        c->state = Client::IDLE;
+    }
+
+    // 伺服器在一局結束後會斷線；時間還沒到就再連一次
+    void restart(Client* c) {
+        stop(c);
+        if (ms() < stop_at) start(c);
+    }
+
+    void write_all(Client* c, const std::string& data) {
+        if (send(c->fd, data.data(), data.size(), MSG_NOSIGNAL) != (ssize_t)data.size()) {
+            totals.errors++;
+            restart(c);
+        }
+    }
+
+    void on_connected(Client* c) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            totals.errors++;
+            restart(c);
+            return;
+        }
+        totals.connects++;
+        c->state = Client::WAITING;
+        std::string name = "load" + std::to_string(c->id) + (opt.vs_cpu ? "@cpu" : "");
+        if (opt.binary) {
+            write_all(c, std::string(1, (char)Protocol::MAGIC) + Protocol::encode(Protocol::C_HELLO, name));
+        } else {
+            write_all(c, name + "\n");
+        }
+    }
+
+    void my_turn(Client* c) {
+        if (opt.think_ms > 0) {
+            wheel.schedule(&c->timer, ms() + opt.think_ms);
+        } else {
+            play(c);
+        }
+    }
+
+    int choose_move(Client* c) {
+        if (engine) {
+            SearchResult r = engine->search(c->game, c->piece, Clock::now() + std::chrono::hours(1), opt.engine_depth);
+            if (!r.is_pass()) return r.row * 8 + r.col;
+        }
+        uint64_t mask = c->game.get_move_mask(c->piece);
+        if (mask == 0) return -1;
+        int n = rng() % Bitboard::popcount(mask);
+        while (n-- > 0) mask &= mask - 1;
+        return __builtin_ctzll(mask);
+    }
+
+    void play(Client* c) {
+        if (c->state != Client::PLAYING) return;
+        int sq = choose_move(c);
+        if (sq < 0) {
+            totals.errors++;
+            return;
+        }
+        c->sent_at = now_us();
+        if (opt.binary) {
+            write_all(c, Protocol::encode(Protocol::C_MOVE, std::string(1, (char)sq)));
+        } else {
+            std::string move;
+            move += (char)('a' + sq % 8);
+            move += (char)('8' - sq / 8);
+            write_all(c, move + "\n");
+        }
+    }
+
+    void record_move(Client* c) {
+        if (c->sent_at == 0) return;
+        rtt_us.record(now_us() - c->sent_at);
+        c->sent_at = 0;
+        totals.moves++;
+    }
+
+    void handle_line(Client* c, Slice rest) {
+        Slice cmd, field;
+        rest.next_token(':', cmd);
+        if (cmd.equals("START")) {
+            Slice name, piece;
+            rest.next_token(':', name);
+            if (!rest.next_token(':', piece) || piece.empty()) {
+                totals.errors++;
+                return;
+            }
+            c->piece = piece[0];
+            c->state = Client::PLAYING;
+        } else if (cmd.equals("YOUR_TURN") || cmd.equals("OPPONENT_TURN")) {
+            if (rest.next_token(':', field)) c->game.set_board_state(field.data, field.size);
+            if (cmd.equals("YOUR_TURN")) my_turn(c);
+        } else if (cmd.equals("MOVE_OK")) {
+            record_move(c);
+        } else if (cmd.equals("INVALID")) {
+            totals.errors++;
+        } else if (cmd.equals("END")) {
+            totals.games++;
+        } else if (cmd.equals("OPPONENT_DISCONNECT")) {
+            totals.disconnects++;
+        }
+    }
+
+    void handle_frame(Client* c, uint8_t type, const Slice& p) {
+        if (type == Protocol::S_START && p.size >= 1) {
+            c->piece = p[0];
+            c->turn = 'X';
+            c->state = Client::PLAYING;
+            if (c->turn == c->piece) my_turn(c);
+        } else if (type == Protocol::S_MOVE && p.size == 3) {
+            int sq = (uint8_t)p[0];
+            c->game.make_move(sq / 8, sq % 8, p[1]);
+            if (p[1] == c->piece) record_move(c);
+            c->turn = p[2];        // 已經算進對手要 pass 的情況，S_PASS 不用另外處理
+            if (c->turn == c->piece) my_turn(c);
+        } else if (type == Protocol::S_INVALID) {
+            totals.errors++;
+        } else if (type == Protocol::S_END) {
+            totals.games++;
+        } else if (type == Protocol::S_OPPONENT_DISCONNECT) {
+            totals.disconnects++;
+        }
+    }
+
+    void on_readable(Client* c) {
+        while (true) {
+            FrameReader::ReadResult r = c->reader.read_from(c->fd);
+            if (opt.binary) {
+                uint8_t type;
+                Slice payload;
+                int n = 0;
+                while (c->fd >= 0 && (n = c->reader.next_frame(type, payload)) > 0) handle_frame(c, type, payload);
+                if (n < 0) r = FrameReader::READ_ERROR;
+            } else {
+                Slice line;
+                while (c->fd >= 0 && c->reader.next_line(line)) handle_line(c, line);
+            }
+            if (c->fd < 0) return;
+            if (r == FrameReader::READ_FULL) continue;
+            if (r == FrameReader::READ_EOF || r == FrameReader::READ_ERROR) restart(c);
+            return;
+        }
+    }
+
+public:
+    Worker(const Options& o, Totals& t, int first_id, int count, unsigned seed)
+        : opt(o), totals(t), epoll_fd(epoll_create1(0)), wheel(ms()), table(NULL), engine(NULL), rng(seed), stop_at(0) {
+        for (int i = 0; i < count; i++) clients.push_back(new Client(first_id + i));
+        if (opt.engine_depth > 0) {
+            table = new TranspositionTable(4);
+            engine = new Engine(table);
+        }
+    }
+
+    ~Worker() {
+        for (size_t i = 0; i < clients.size(); i++) {
+            stop(clients[i]);
+            delete clients[i];
+        }
+        delete engine;
+        delete table;
+        close(epoll_fd);
+    }
+
+    const Histogram& latency() const { return rtt_us; }
+
+    void run() {
+        stop_at = ms() + (uint64_t)(opt.duration * 1000);
+        for (size_t i = 0; i < clients.size(); i++) start(clients[i]);
+
+        struct epoll_event events[256];
+        while (ms() < stop_at) {
+            int timeout = 100;
+            uint64_t deadline = wheel.next_deadline();
+            if (deadline != UINT64_MAX) {
+                uint64_t now = ms();
+                timeout = (deadline <= now) ? 0 : (int)std::min<uint64_t>(deadline - now, 100);
+            }
+            int n = epoll_wait(epoll_fd, events, 256, timeout);
+            for (int i = 0; i < n; i++) {
+                Client* c = static_cast<Client*>(events[i].data.ptr);
+                if (c->state == Client::CONNECTING) {
+                    if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) on_connected(c);
+                    if (c->state == Client::CONNECTING || c->fd < 0) continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) on_readable(c);
+            }
+
+            wheel.advance(ms());
+            while (TimingWheel::Timer* t = wheel.pop_ready()) {
+                play(static_cast<Client*>(t->owner));
+            }
+        }
+    }
+};
+
+static void usage(const char* prog) {
+    std::cout << "Usage: " << prog << " <ip> <port> [options]\n"
+              << "  --clients <n>     concurrent connections (default 100)\n"
+              << "  --threads <n>     worker threads (default 1)\n"
+              << "  --duration <s>    run time in seconds (default 10)\n"
+              << "  --think <ms>      delay before each move (default 0)\n"
+              << "  --engine <depth>  pick moves with a fixed-depth search instead of at random\n"
+              << "  --binary          use the binary protocol instead of text lines\n"
+              << "  --vs-cpu          play against the server's computer opponents instead of each other\n";
+}
+
+static void print_rate(const char* label, unsigned long long n, double seconds) {
+    std::cout << std::setw(10) << label << std::setw(12) << n
+              << std::setw(12) << std::fixed << std::setprecision(1) << n / seconds << "/s\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Options opt;
+    opt.ip = argv[1];
+    opt.port = atoi(argv[2]);
+    opt.clients = 100;
+    opt.threads = 1;
+    opt.duration = 10;
+    opt.think_ms = 0;
+    opt.engine_depth = 0;
+    opt.binary = false;
+    opt.vs_cpu = false;
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--clients" && i + 1 < argc) {
+            opt.clients = atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            opt.threads = atoi(argv[++i]);
+        } else if (arg == "--duration" && i + 1 < argc) {
+            opt.duration = atof(argv[++i]);
+        } else if (arg == "--think" && i + 1 < argc) {
+            opt.think_ms = atoi(argv[++i]);
+        } else if (arg == "--engine" && i + 1 < argc) {
+            opt.engine_depth = atoi(argv[++i]);
+        } else if (arg == "--binary") {
+            opt.binary = true;
+        } else if (arg == "--vs-cpu") {
+            opt.vs_cpu = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.threads < 1) opt.threads = 1;
+    if (opt.clients < opt.threads) opt.threads = opt.clients;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    Totals totals;
+    std::vector<Worker*> workers;
+    for (int t = 0; t < opt.threads; t++) {
+        int first = opt.clients * t / opt.threads;
+        int last = opt.clients * (t + 1) / opt.threads;
+        workers.push_back(new Worker(opt, totals, first, last - first, 1000 + t));
+    }
+
+    std::cout << "Running " << opt.clients << " clients on " << opt.threads << " thread"
+              << (opt.threads > 1 ? "s" : "") << " for " << opt.duration << "s ("
+              << (opt.binary ? "binary" : "text") << " protocol, "
+              << (opt.engine_depth > 0 ? "engine depth " + std::to_string(opt.engine_depth) : std::string("random moves"))
+              << ", think " << opt.think_ms << " ms)\n";
+
+    Clock::time_point begin = Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workers.size(); i++) {
+        threads.push_back(std::thread(&Worker::run, workers[i]));
+    }
+
+    // 對下時一局有兩條連線各收到一次 END
+    unsigned long long per_game = opt.vs_cpu ? 1 : 2;
+
+    // 每秒印一次進度
+    unsigned long long last_moves = 0;
+    while (std::chrono::duration<double>(Clock::now() - begin).count() + 1 <= opt.duration) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        unsigned long long moves = totals.moves;
+        std::cout << "  " << std::setw(4) << (int)std::chrono::duration<double>(Clock::now() - begin).count() << "s  "
+                  << moves - last_moves << " moves/s, " << totals.games / per_game << " games\n";
+        last_moves = moves;
+    }
+
+    for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    Histogram latency;
+    for (size_t i = 0; i < workers.size(); i++) {
+        latency.merge(workers[i]->latency());
+        delete workers[i];
+    }
+
+    // 每局兩位玩家各收到一次 END
+    std::cout << "\n";
+    print_rate("games", totals.games / per_game, seconds);
+    print_rate("moves", totals.moves, seconds);
+    print_rate("connects", totals.connects, seconds);
+    std::cout << std::setw(10) << "errors" << std::setw(12) << totals.errors << "\n"
+              << std::setw(10) << "aborted" << std::setw(12) << totals.disconnects << "\n\n";
+
+    std::cout << "Move round-trip latency (us), " << latency.count() << " samples\n";
+    const double points[] = {50, 90, 99, 99.9};
+    const char* names[] = {"p50", "p90", "p99", "p999"};
+    for (int i = 0; i < 4; i++) {
+        std::cout << std::setw(10) << names[i] << std::setw(12) << latency.percentile(points[i]) << "\n";
+    }
+    std::cout << std::setw(10) << "max" << std::setw(12) << latency.max() << "\n";
+    return totals.errors > 0 ? 2 : 0;
+}
@@ -0,0 +1,324 @@
+#ifndef MCTS_HPP
+#define MCTS_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include "game.hpp"
+#include "bitboard.hpp"
+
+// MCTS 搜尋結果：row/col 為 -1 代表沒有合法步（必須 pass）
+struct MctsResult {
+    int row;
+    int col;
+    double win_rate;            // 以要下的一方為視角，0~1（和棋算半勝）
+    unsigned long long playouts;
+    size_t nodes;               // 用掉的樹節點數
+
+    MctsResult() : row(-1), col(-1), win_rate(0.5), playouts(0), nodes(0) {}
+
+    bool is_pass() const { return row < 0; }
+
+    std::string move_string() const {
+        if (is_pass()) return "pass";
+        std::string s;
+        s += (char)('a' + col);
+        s += (char)('8' - row);
+        return s;
+    }
+};
+
+// 蒙地卡羅樹搜尋（UCT），與 alpha-beta 的 Engine 並存
+//
+// 節點從預先配置的 arena 取得（一次取一整組兄弟節點，索引相鄰），不逐一 new；
+// arena 用完時樹不再長大，只繼續 playout 與更新統計。
+// 平行方式為 tree parallelism：所有執行緒共用同一棵樹，統計全部是 atomic。
+// 往下選的時候就先把 visits 加一，結果回來才加 wins（virtual loss），
+// 正在被其他執行緒搜的分支勝率暫時變低，大家自然分散到不同分支。
+class MctsSearch {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // RANDOM：合法步裡隨機選；PATTERN：有角先下角，角還空著時避開旁邊的 X、C 格
+    enum Playout { RANDOM, PATTERN };
+
+    static const int PASS = 64;
+    static const int EXPAND_VISITS = 2;     // 葉節點被走到第二次才展開
+    static const int MAX_PATH = 128;        // 60 步加上 pass
+
+private:
+    enum NodeState { UNEXPANDED = 0, EXPANDING = 1, EXPANDED = 2 };
+
+    struct Node {
+        std::atomic<uint32_t> visits;
+        std::atomic<uint32_t> wins;         // 半分為單位（勝 2、和 1），以走到這個節點的一方為視角
+        uint32_t first_child;               // state 為 EXPANDED 之後才可讀
+        std::atomic<uint8_t> state;
+        uint8_t child_count;
+        uint8_t move;                       // 0..63 或 PASS
+    };
+
+    static const uint64_t CORNERS = 0x8100000000000081ULL;
+    // 根節點加上它所有的子節點（最多 64 個）一定放得下，不然根節點展開不了
+    static const uint32_t MIN_NODES = 65;
+
+    Node* nodes;
+    uint32_t capacity;
+    std::atomic<uint32_t> used;
+    std::atomic<bool> full;                 // arena 已用完
+    int thread_count;
+    Playout policy;
+    double exploration;
+    std::atomic<bool> stop;
+    std::atomic<unsigned long long> total_playouts;
+
+    MctsSearch(const MctsSearch&);
+    MctsSearch& operator=(const MctsSearch&);
+
+    // 每個執行緒自己的亂數（xorshift64）
+    struct Rng {
+        uint64_t s;
+        explicit Rng(uint64_t seed) : s(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+        uint64_t next() {
+            s ^= s << 13;
+            s ^= s >> 7;
+            s ^= s << 17;
+            return s;
+        }
+    };
+
+    static int random_square(uint64_t mask, Rng& rng) {
+        int n = (int)(rng.next() % Bitboard::popcount(mask));
+        while (n-- > 0) mask &= mask - 1;
+        return __builtin_ctzll(mask);
+    }
+
+    // 空角旁邊的 X、C 格
+    static uint64_t danger_squares(uint64_t empty) {
+        uint64_t danger = 0;
+        if (empty & (1ULL << 0)) danger |= (1ULL << 1) | (1ULL << 8) | (1ULL << 9);
+        if (empty & (1ULL << 7)) danger |= (1ULL << 6) | (1ULL << 15) | (1ULL << 14);
+        if (empty & (1ULL << 56)) danger |= (1ULL << 57) | (1ULL << 48) | (1ULL << 49);
+        if (empty & (1ULL << 63)) danger |= (1ULL << 62) | (1ULL << 55) | (1ULL << 54);
+        return danger;
+    }
+
+    int pick_move(uint64_t moves, uint64_t P, uint64_t O, Rng& rng) const {
+        if (policy == PATTERN) {
+            uint64_t corners = moves & CORNERS;
+            if (corners) return random_square(corners, rng);
+            uint64_t safe = moves & ~danger_squares(~(P | O));
+            if (safe) return random_square(safe, rng);
+        }
+        return random_square(moves, rng);
+    }
+
+    static void play(uint64_t& P, uint64_t& O, int sq) {
+        if (sq != PASS) {
+            uint64_t flips = Bitboard::get_flips(P, O, sq);
+            P |= flips | (1ULL << sq);
+            O &= ~flips;
+        }
+        uint64_t t = P;
+        P = O;
+        O = t;
+    }
+
+    // 下到終局，回傳黑子減白子；side 為輪到的一方（0 黑、1 白）
+    int playout(uint64_t P, uint64_t O, int side, Rng& rng) const {
+        while (true) {
+            uint64_t moves = Bitboard::get_moves(P, O);
+            if (!moves) {
+                if (!Bitboard::get_moves(O, P)) break;
+                play(P, O, PASS);
+                side ^= 1;
+                continue;
+            }
+            play(P, O, pick_move(moves, P, O, rng));
+            side ^= 1;
+        }
+        int diff = Bitboard::popcount(P) - Bitboard::popcount(O);
+        return side == 0 ? diff : -diff;
+    }
+
+    // 一次取 count 個相鄰的節點；不夠時回傳 false
+    bool allocate(uint32_t count, uint32_t& first) {
+        if (full.load(std::memory_order_relaxed)) return false;
+        first = used.fetch_add(count, std::memory_order_relaxed);
+        if (first + count > capacity) {
+            full.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        for (uint32_t i = first; i < first + count; i++) {
+            nodes[i].visits.store(0, std::memory_order_relaxed);
+            nodes[i].wins.store(0, std::memory_order_relaxed);
+            nodes[i].state.store(UNEXPANDED, std::memory_order_relaxed);
+            nodes[i].child_count = 0;
+        }
+        return true;
+    }
+
+    // 只有搶到 EXPANDING 的執行緒會展開，其他執行緒這一輪直接從葉節點 playout
+    void expand(Node& node, uint64_t P, uint64_t O) {
+        uint8_t expected = UNEXPANDED;
+        if (!node.state.compare_exchange_strong(expected, EXPANDING, std::memory_order_acquire)) return;
+
+        uint64_t moves = Bitboard::get_moves(P, O);
+        uint32_t count = moves ? Bitboard::popcount(moves) : (Bitboard::get_moves(O, P) ? 1 : 0);
+        uint32_t first = 0;
+        if (count > 0 && !allocate(count, first)) {
+            node.state.store(UNEXPANDED, std::memory_order_release);
+            return;
+        }
+        if (moves) {
+            for (uint32_t i = 0; i < count; i++) nodes[first + i].move = (uint8_t)Bitboard::pop_lsb(moves);
+        } else if (count == 1) {
+            nodes[first].move = PASS;
+        }
+        node.first_child = first;
+        node.child_count = (uint8_t)count;
+        node.state.store(EXPANDED, std::memory_order_release);
+    }
+
+    // UCT：勝率 + exploration * sqrt(ln N / n)；還沒走過的子節點優先
+    uint32_t select(const Node& node) const {
+        double log_parent = std::log((double)node.visits.load(std::memory_order_relaxed) + 1);
+        uint32_t best = node.first_child;
+        double best_value = -1;
+        for (uint32_t i = node.first_child; i < node.first_child + node.child_count; i++) {
+            uint32_t n = nodes[i].visits.load(std::memory_order_relaxed);
+            if (n == 0) return i;
+            double value = nodes[i].wins.load(std::memory_order_relaxed) / (2.0 * n) +
+                           exploration * std::sqrt(log_parent / n);
+            if (value > best_value) {
+                best_value = value;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    // 一次模擬：選擇 → 展開 → playout → 倒傳
+    void simulate(uint64_t P, uint64_t O, int side, Rng& rng) {
+        uint32_t path[MAX_PATH];
+        int movers[MAX_PATH];
+        int length = 0;
+        uint32_t index = 0;
+        nodes[0].visits.fetch_add(1, std::memory_order_relaxed);
+
+        while (length < MAX_PATH) {
+            Node& node = nodes[index];
+            uint8_t state = node.state.load(std::memory_order_acquire);
+            if (state == UNEXPANDED && node.visits.load(std::memory_order_relaxed) >= EXPAND_VISITS) {
+                expand(node, P, O);
+                state = node.state.load(std::memory_order_acquire);
+            }
+            if (state != EXPANDED || node.child_count == 0) break;
+
+            index = select(node);
+            nodes[index].visits.fetch_add(1, std::memory_order_relaxed);
+            path[length] = index;
+            movers[length] = side;
+            length++;
+            play(P, O, nodes[index].move);
+            side ^= 1;
+        }
+
+        int black_minus_white = playout(P, O, side, rng);
+        for (int i = 0; i < length; i++) {
+            int diff = movers[i] == 0 ? black_minus_white : -black_minus_white;
+            uint32_t reward = diff > 0 ? 2 : (diff == 0 ? 1 : 0);
+            if (reward) nodes[path[i]].wins.fetch_add(reward, std::memory_order_relaxed);
+        }
+    }
+
+    void worker(uint64_t P, uint64_t O, int side, Clock::time_point deadline,
+                unsigned long long max_playouts, uint64_t seed) {
+        Rng rng(seed);
+        unsigned long long local = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            simulate(P, O, side, rng);
+            local++;
+            // 每 64 次才看一次時間與總次數，避免共用的計數器成為瓶頸
+            if ((local & 63) == 0) {
+                unsigned long long total = total_playouts.fetch_add(64, std::memory_order_relaxed) + 64;
+                if ((max_playouts && total >= max_playouts) || Clock::now() >= deadline) stop.store(true);
+            }
+        }
+        total_playouts.fetch_add(local & 63, std::memory_order_relaxed);
+    }
+
+public:
+    // max_nodes 為 arena 大小（每個節點 16 bytes），至少 MIN_NODES
+    explicit MctsSearch(int threads = 1, uint32_t max_nodes = 1 << 20, Playout playout_policy = PATTERN)
+        : capacity(max_nodes < MIN_NODES ? MIN_NODES : max_nodes), used(0), full(false), policy(playout_policy),
+          exploration(0.7), stop(false), total_playouts(0) {
+        nodes = new Node[capacity];
+        set_threads(threads);
+    }
+
+    ~MctsSearch() {
+        delete[] nodes;
+    }
+
+    void set_threads(int threads) { thread_count = threads < 1 ? 1 : threads; }
+    int get_threads() const { return thread_count; }
+    void set_playout(Playout p) { policy = p; }
+    void set_exploration(double c) { exploration = c; }
+
+    // 在 deadline 之前（或做滿 max_playouts 次，0 為不限）盡量模擬，回傳走過最多次的一步
+    MctsResult search(const Game& game, char player, Clock::time_point deadline, unsigned long long max_playouts = 0) {
+        uint64_t P = game.get_pieces(player);
+        uint64_t O = game.get_pieces(player == 'X' ? 'O' : 'X');
+        int side = (player == 'X') ? 0 : 1;
+        MctsResult result;
+        if (!Bitboard::get_moves(P, O)) return result;
+
+        // 每次搜尋從空的 arena 開始，根節點先展開
+        used.store(1);
+        full.store(false);
+        stop.store(false);
+        total_playouts.store(0);
+        nodes[0].visits.store(0);
+        nodes[0].wins.store(0);
+        nodes[0].state.store(UNEXPANDED);
+        nodes[0].child_count = 0;
+        nodes[0].move = PASS;
+        expand(nodes[0], P, O);
+
+        uint64_t seed = (uint64_t)Clock::now().time_since_epoch().count();
+        std::vector<std::thread> helpers;
+        for (int i = 1; i < thread_count; i++) {
+            helpers.push_back(std::thread(&MctsSearch::worker, this, P, O, side, deadline, max_playouts,
+                                          seed + 0x9E3779B97F4A7C15ULL * i));
+        }
+        worker(P, O, side, deadline, max_playouts, seed);
+        for (size_t i = 0; i < helpers.size(); i++) {
+            helpers[i].join();
+        }
+
+        const Node& root = nodes[0];
+        uint32_t best = root.first_child;
+        for (uint32_t i = root.first_child; i < root.first_child + root.child_count; i++) {
+            if (nodes[i].visits.load() > nodes[best].visits.load()) best = i;
+        }
+        result.row = nodes[best].move / 8;
+        result.col = nodes[best].move % 8;
+        uint32_t visits = nodes[best].visits.load();
+        if (visits > 0) result.win_rate = nodes[best].wins.load() / (2.0 * visits);
+        result.playouts = total_playouts.load();
+        uint32_t n = used.load();
+        result.nodes = n < capacity ? n : capacity;
+        return result;
+    }
+
+    MctsResult search_for(const Game& game, char player, int millis, unsigned long long max_playouts = 0) {
+        return search(game, player, Clock::now() + std::chrono::milliseconds(millis), max_playouts);
+    }
+};
+
+#endif // MCTS_HPP
@@ -0,0 +1,275 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+// 伺服器執行時的統計
+//
+// 每個 reactor 一個 MetricsShard，只有自己的執行緒會寫，所以更新用 relaxed 的
+// load + store 就好（不需要 lock 前綴的指令）；讀取端把所有分片加總。
+// 連線在 reactor 之間交接時，開啟與關閉可能記在不同分片，加總後仍然正確。
+
+// 單一寫入者的計數器
+class Counter {
+private:
+    std::atomic<uint64_t> value;
+
+public:
+    Counter() : value(0) {}
+
+    void add(uint64_t n = 1) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    void sub(uint64_t n) { value.store(value.load(std::memory_order_relaxed) - n, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+};
+
+// 固定分桶的延遲直方圖（Prometheus 的累積 le 格式），單位 ns
+class LatencyHistogram {
+public:
+    static const int BUCKETS = 14;
+
+    static uint64_t bound(int i) {
+        static const uint64_t bounds[BUCKETS] = {
+            100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+            100000, 250000, 1000000, 10000000, 100000000
+        };
+        return bounds[i];
+    }
+
+private:
+    Counter counts[BUCKETS + 1];        // 最後一格是 +Inf
+    Counter sum_ns;
+
+public:
+    void observe(uint64_t ns) {
+        int i = 0;
+        while (i < BUCKETS && ns > bound(i)) i++;
+        counts[i].add();
+        sum_ns.add(ns);
+    }
+
+    uint64_t count(int i) const { return counts[i].get(); }
+    uint64_t sum() const { return sum_ns.get(); }
+};
+
+// 各分片分開配置，結尾補一條 cache line，避免相鄰分片互相 false sharing
+// （C++11 的 new 不保證 alignas(64)，所以用補空間的方式）
+struct MetricsShard {
+    Counter connections_opened;
+    Counter connections_closed;
+    Counter rooms_started;
+    Counter rooms_finished;
+    Counter spectators_joined;
+    Counter spectators_left;
+    Counter moves;
+    Counter invalid_moves;
+    Counter bytes_sent;
+    Counter queued_bytes;               // 各分片可能暫時為「負」，加總後才是實際值
+    Counter slow_consumers_dropped;
+
+    // 一步棋的各階段：解析、合法性檢查、套用到盤面、送給雙方與觀戰者
+    LatencyHistogram parse;
+    LatencyHistogram validate;
+    LatencyHistogram apply;
+    LatencyHistogram broadcast;
+
+    char padding[64];
+};
+
+class Metrics {
+private:
+    // 不在分片裡的數值（例如電腦對手的工作池），抓取時才讀
+    struct Probe {
+        const char* name;
+        const char* type;
+        const char* help;
+        std::function<uint64_t()> read;
+    };
+
+    std::vector<MetricsShard*> shards;
+    std::vector<Probe> probes;
+
+    Metrics(const Metrics&);
+    Metrics& operator=(const Metrics&);
+
+    uint64_t total(Counter MetricsShard::*field) const {
+        uint64_t n = 0;
+        for (size_t i = 0; i < shards.size(); i++) n += (shards[i]->*field).get();
+        return n;
+    }
+
+    static void header(std::ostringstream& out, const char* name, const char* type, const char* help) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+    }
+
+    static void value(std::ostringstream& out, const char* name, const char* type, const char* help, uint64_t v) {
+        header(out, name, type, help);
+        out << name << " " << v << "\n";
+    }
+
+    void stage(std::ostringstream& out, const char* label, LatencyHistogram MetricsShard::*field) const {
+        uint64_t cumulative = 0;
+        uint64_t sum = 0;
+        for (int b = 0; b <= LatencyHistogram::BUCKETS; b++) {
+            for (size_t i = 0; i < shards.size(); i++) cumulative += (shards[i]->*field).count(b);
+            out << "reversi_move_stage_seconds_bucket{stage=\"" << label << "\",le=\"";
+            if (b < LatencyHistogram::BUCKETS) {
+                out << LatencyHistogram::bound(b) / 1e9;
+            } else {
+                out << "+Inf";
+            }
+            out << "\"} " << cumulative << "\n";
+        }
+        for (size_t i = 0; i < shards.size(); i++) sum += (shards[i]->*field).sum();
+        out << "reversi_move_stage_seconds_sum{stage=\"" << label << "\"} " << sum / 1e9 << "\n";
+        out << "reversi_move_stage_seconds_count{stage=\"" << label << "\"} " << cumulative << "\n";
+    }
+
+public:
+    explicit Metrics(int count) {
+        for (int i = 0; i < count; i++) shards.push_back(new MetricsShard());
+    }
+
+    ~Metrics() {
+        for (size_t i = 0; i < shards.size(); i++) delete shards[i];
+    }
+
+    MetricsShard& shard(int i) { return *shards[i]; }
+
+    // 要在開啟端點之前登記
+    void add_probe(const char* name, const char* type, const char* help, const std::function<uint64_t()>& read) {
+        Probe p = {name, type, help, read};
+        probes.push_back(p);
+    }
+
+    // Prometheus 文字格式
+    std::string render() const {
+        std::ostringstream out;
+        value(out, "reversi_connections_active", "gauge", "Open client connections",
+              total(&MetricsShard::connections_opened) - total(&MetricsShard::connections_closed));
+        value(out, "reversi_connections_total", "counter", "Accepted client connections",
+              total(&MetricsShard::connections_opened));
+        value(out, "reversi_rooms_active", "gauge", "Games in progress",
+              total(&MetricsShard::rooms_started) - total(&MetricsShard::rooms_finished));
+        value(out, "reversi_rooms_total", "counter", "Games started",
+              total(&MetricsShard::rooms_started));
+        value(out, "reversi_spectators_active", "gauge", "Connections watching a game",
+              total(&MetricsShard::spectators_joined) - total(&MetricsShard::spectators_left));
+        value(out, "reversi_moves_total", "counter", "Moves played",
+              total(&MetricsShard::moves));
+        value(out, "reversi_invalid_moves_total", "counter", "Moves rejected (bad format, wrong turn or illegal)",
+              total(&MetricsShard::invalid_moves));
+        value(out, "reversi_sent_bytes_total", "counter", "Bytes written to client sockets",
+              total(&MetricsShard::bytes_sent));
+        value(out, "reversi_send_queue_bytes", "gauge", "Bytes waiting in per-connection output queues",
+              total(&MetricsShard::queued_bytes));
+        value(out, "reversi_slow_consumers_dropped_total", "counter", "Connections dropped for not reading",
+              total(&MetricsShard::slow_consumers_dropped));
+        for (size_t i = 0; i < probes.size(); i++) {
+            value(out, probes[i].name, probes[i].type, probes[i].help, probes[i].read());
+        }
+
+        header(out, "reversi_move_stage_seconds", "histogram", "Time spent in each stage of handling a move");
+        stage(out, "parse", &MetricsShard::parse);
+        stage(out, "validate", &MetricsShard::validate);
+        stage(out, "apply", &MetricsShard::apply);
+        stage(out, "broadcast", &MetricsShard::broadcast);
+        return out.str();
+    }
+};
+
+// 獨立於遊戲 port 的統計端點：路徑開頭為 / 時是 Unix socket，否則是 127.0.0.1 的 port。
+// 抓取很少發生，用一條阻塞的執行緒處理，不影響 reactor。
+// 收到 HTTP 請求時加上回應標頭，直接連上（例如 nc）時只送出內容。
+class MetricsEndpoint {
+private:
+    const Metrics& metrics;
+    int listen_fd;
+    std::thread thread;
+
+    MetricsEndpoint(const MetricsEndpoint&);
+    MetricsEndpoint& operator=(const MetricsEndpoint&);
+
+    void serve() {
+        while (true) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                return;
+            }
+            struct timeval tv = {0, 200 * 1000};
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            char request[512];
+            ssize_t n = recv(fd, request, sizeof(request), 0);
+
+            std::string body = metrics.render();
+            std::string response;
+            if (n >= 3 && memcmp(request, "GET", 3) == 0) {
+                response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\n\r\n";
+            }
+            response += body;
+            size_t sent = 0;
+            while (sent < response.size()) {
+                ssize_t w = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (w <= 0) break;
+                sent += w;
+            }
+            close(fd);
+        }
+    }
+
+public:
+    explicit MetricsEndpoint(const Metrics& m) : metrics(m), listen_fd(-1) {}
+
+    ~MetricsEndpoint() {
+        if (listen_fd != -1) {
+            shutdown(listen_fd, SHUT_RDWR);
+            close(listen_fd);
+        }
+        if (thread.joinable()) thread.join();
+    }
+
+    bool start(const std::string& where) {
+        if (!where.empty() && where[0] == '/') {
+            struct sockaddr_un address;
+            memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            if (where.size() >= sizeof(address.sun_path)) return false;
+            strcpy(address.sun_path, where.c_str());
+            unlink(where.c_str());
+            listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0) return false;
+        } else {
+            struct sockaddr_in address;
+            memset(&address, 0, sizeof(address));
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port = htons(atoi(where.c_str()));
+            listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+            int opt = 1;
+            if (listen_fd < 0) return false;
+            setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+            if (bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0) return false;
+        }
+        if (listen(listen_fd, 16) < 0) return false;
+        thread = std::thread(&MetricsEndpoint::serve, this);
+        return true;
+    }
+};
+
+#endif // METRICS_HPP
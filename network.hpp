@@ -3,8 +3,6 @@
 
 #include <iostream>
 #include <string>
-#include <vector>
-#include <sstream>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -12,6 +10,8 @@
 #include <cstring>
 #include <fcntl.h>
 #include <errno.h>
+#include "protocol.hpp"
+#include "frame.hpp"
 
 class NetworkClient {
 private:
@@ -20,21 +20,14 @@ private:
     std::string opponent_name;
     char my_piece;
     bool connected;
-    
-    std::vector<std::string> split(const std::string& s, char delimiter) {
-        std::vector<std::string> tokens;
-        std::string token;
-        std::istringstream tokenStream(s);
-        while (std::getline(tokenStream, token, delimiter)) {
-            tokens.push_back(token);
-        }
-        return tokens;
-    }
+    bool binary;               // 使用二進位協定（見 protocol.hpp）
+    FrameReader reader;        // 收到但還沒處理完的資料（跨 TCP 封包的訊息會在這裡湊齊）
     
 public:
     NetworkClient() {
         sock = -1;
         connected = false;
+        binary = false;
         my_piece = ' ';
     }
     
@@ -42,8 +35,11 @@ public:
         disconnect();
     }
     
-    bool connect_to_server(const std::string& host, int port, const std::string& name) {
+    // use_binary 為 false 時使用舊版文字協定，可連線到舊版伺服器
+    bool connect_to_server(const std::string& host, int port, const std::string& name, bool use_binary = true) {
         player_name = name;
+        binary = use_binary;
+        reader.clear();
         
         std::cout << "[NETWORK] Connecting to " << host << ":" << port << std::endl;
         
@@ -75,6 +71,15 @@ public:
         std::cout << "[NETWORK] Connected successfully" << std::endl;
         connected = true;
         
+        if (binary) {
+            // 先送 MAGIC 表示要用二進位協定，再用 HELLO 送名字
+            std::string hello(1, (char)Protocol::MAGIC);
+            hello += Protocol::encode(Protocol::C_HELLO, player_name);
+            std::cout << "[NETWORK] Sending name (binary protocol): " << player_name << std::endl;
+            send(sock, hello.data(), hello.size(), 0);
+            return true;
+        }
+        
         // 發送玩家名字（不加換行符，server 會自己讀取）
         std::cout << "[NETWORK] Sending name: " << player_name << std::endl;
         ssize_t sent = send(sock, player_name.c_str(), player_name.length(), 0);
@@ -96,54 +101,59 @@ public:
     }
     
     void send_move(const std::string& move) {
-        if (is_connected()) {
+        if (!is_connected()) return;
+        if (binary) {
+            if (move.length() != 2) return;
+            int row = '8' - move[1], col = move[0] - 'a';
+            std::string frame = Protocol::encode(Protocol::C_MOVE, std::string(1, (char)(row * 8 + col)));
+            send(sock, frame.data(), frame.size(), 0);
+        } else {
             send(sock, move.c_str(), move.length(), 0);
         }
     }
     
-    std::string receive_message() {
-        if (!is_connected()) return "";
-        
-        char buffer[1024] = {0};
-        
-        // 使用 MSG_DONTWAIT 標誌來非阻塞接收
-        int n = recv(sock, buffer, sizeof(buffer) - 1, MSG_DONTWAIT);
-        
-        if (n < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // 沒有資料可讀，正常情況
-                return "";
-            }
-            // 其他錯誤，斷線
-            std::cerr << "[NETWORK] recv error: " << strerror(errno) << std::endl;
-            connected = false;
-            return "";
+    // 本地盤面和伺服器對不上時，要求伺服器送完整盤面
+    void request_resync() {
+        if (is_connected() && binary) {
+            std::string frame = Protocol::encode(Protocol::C_RESYNC);
+            send(sock, frame.data(), frame.size(), 0);
         }
+    }
+    
+    // 把 socket 上目前讀得到的資料收進接收緩衝（不會阻塞）
+    void receive() {
+        if (!is_connected()) return;
         
-        if (n == 0) {
-            // 連線關閉
+        FrameReader::ReadResult r = reader.read_from(sock, MSG_DONTWAIT);
+        if (r == FrameReader::READ_EOF) {
             std::cerr << "[NETWORK] Connection closed by server" << std::endl;
             connected = false;
-            return "";
+        } else if (r == FrameReader::READ_ERROR) {
+            std::cerr << "[NETWORK] recv error: " << strerror(errno) << std::endl;
+            connected = false;
         }
-        
-        buffer[n] = '\0';
-        std::string result(buffer);
-        std::cout << "[NETWORK] Received " << n << " bytes: " << result << std::endl;
-        return result;
     }
     
-    // 解析訊息並回傳命令類型
-    std::string parse_message(const std::string& msg, std::vector<std::string>& parts) {
-        parts = split(msg, ':');
-        if (parts.empty()) return "";
-        return parts[0];
+    // 取出下一則文字訊息；line 指向接收緩衝，下一次 receive() 之前有效
+    bool next_line(Slice& line) {
+        return reader.next_line(line);
+    }
+    
+    // 取出下一則二進位訊息：1 = 取到、0 = 還不完整、-1 = 格式錯誤（會斷線）
+    int next_frame(uint8_t& type, Slice& payload) {
+        int r = reader.next_frame(type, payload);
+        if (r < 0) {
+            std::cerr << "[NETWORK] Malformed frame from server" << std::endl;
+            connected = false;
+        }
+        return r;
     }
     
     std::string get_player_name() const { return player_name; }
     std::string get_opponent_name() const { return opponent_name; }
     void set_opponent_name(const std::string& name) { opponent_name = name; }
     char get_my_piece() const { return my_piece; }
+    bool is_binary() const { return binary; }
     void set_my_piece(char piece) { my_piece = piece; }
     
     int get_socket() const { return sock; }
@@ -0,0 +1,91 @@
+#ifndef OUTPUT_QUEUE_HPP
+#define OUTPUT_QUEUE_HPP
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <errno.h>
+
+// 每條連線一個的輸出佇列
+//
+// 每則訊息是一塊不可修改的 shared_ptr 緩衝，同一塊可以同時排在多條連線上；
+// 寫出時用 writev 一次送出多塊，寫不完的部分記在 offset，等 socket 可寫再繼續。
+class OutputQueue {
+public:
+    typedef std::shared_ptr<const std::string> Buffer;
+    enum WriteResult { WRITE_DONE, WRITE_AGAIN, WRITE_ERROR };
+
+private:
+    static const int MAX_IOV = 64;
+
+    std::deque<Buffer> chunks;
+    size_t offset;              // 第一塊已經寫出的長度
+    size_t bytes;               // 還沒寫出的總長度
+
+    OutputQueue(const OutputQueue&);
+    OutputQueue& operator=(const OutputQueue&);
+
+    void consume(size_t n) {
+        bytes -= n;
+        while (n > 0) {
+            size_t left = chunks.front()->size() - offset;
+            if (n < left) {
+                offset += n;
+                return;
+            }
+            n -= left;
+            offset = 0;
+            chunks.pop_front();
+        }
+    }
+
+public:
+    OutputQueue() : offset(0), bytes(0) {}
+
+    size_t size() const { return bytes; }
+    bool empty() const { return bytes == 0; }
+
+    void push(const Buffer& buffer) {
+        if (buffer->empty()) return;
+        chunks.push_back(buffer);
+        bytes += buffer->size();
+    }
+
+    void push(const std::string& data) {
+        if (data.empty()) return;
+        push(std::make_shared<const std::string>(data));
+    }
+
+    void clear() {
+        chunks.clear();
+        offset = 0;
+        bytes = 0;
+    }
+
+    // 寫到佇列清空（WRITE_DONE）或 socket 寫不下（WRITE_AGAIN）為止
+    WriteResult write_to(int fd) {
+        while (bytes > 0) {
+            struct iovec iov[MAX_IOV];
+            int count = 0;
+            for (std::deque<Buffer>::const_iterator it = chunks.begin();
+                 it != chunks.end() && count < MAX_IOV; ++it, ++count) {
+                size_t skip = (count == 0) ? offset : 0;
+                iov[count].iov_base = const_cast<char*>((*it)->data() + skip);
+                iov[count].iov_len = (*it)->size() - skip;
+            }
+
+            ssize_t n = writev(fd, iov, count);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return WRITE_AGAIN;
+                return WRITE_ERROR;
+            }
+            consume((size_t)n);
+        }
+        return WRITE_DONE;
+    }
+};
+
+#endif // OUTPUT_QUEUE_HPP
@@ -0,0 +1,141 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include "game.hpp"
+#include "array_game.hpp"
+#include "bitboard.hpp"
+
+// 從初始局面展開的葉節點數（Aart Bik 公布的 Othello perft 數值）
+// 無子可下時「pass」也算一層，雙方皆無子可下的終局算一個葉節點
+static const unsigned long long KNOWN_PERFT[] = {
+    1ULL,
+    4ULL,
+    12ULL,
+    56ULL,
+    244ULL,
+    1396ULL,
+    8200ULL,
+    55092ULL,
+    390216ULL,
+    3005288ULL,
+    24571284ULL,
+    212258800ULL,
+    1939886636ULL,
+    18429641748ULL,
+    184042084512ULL,
+};
+static const int MAX_KNOWN_DEPTH = sizeof(KNOWN_PERFT) / sizeof(KNOWN_PERFT[0]) - 1;
+
+// 透過公開 API（get_valid_moves / make_move）展開，ArrayGame 與 Game 共用
+template <typename G>
+unsigned long long perft_api(G& game, char player, int depth, bool passed) {
+    if (depth == 0) return 1;
+
+    char opponent = (player == 'X') ? 'O' : 'X';
+    std::vector<std::pair<int, int>> moves = game.get_valid_moves(player);
+
+    if (moves.empty()) {
+        if (passed) return 1;  // 雙方都無子可下：終局
+        return perft_api(game, opponent, depth - 1, true);
+    }
+
+    if (depth == 1) return moves.size();
+
+    unsigned long long nodes = 0;
+    for (size_t i = 0; i < moves.size(); i++) {
+        G child = game;
+        child.make_move(moves[i].first, moves[i].second, player);
+        nodes += perft_api(child, opponent, depth - 1, false);
+    }
+    return nodes;
+}
+
+// 直接在位元棋盤上展開，不經過 std::vector 與 Game 物件
+unsigned long long perft_bitboard(uint64_t P, uint64_t O, int depth, bool passed) {
+    if (depth == 0) return 1;
+
+    uint64_t moves = Bitboard::get_moves(P, O);
+    if (moves == 0) {
+        if (passed) return 1;
+        return perft_bitboard(O, P, depth - 1, true);
+    }
+
+    if (depth == 1) return Bitboard::popcount(moves);
+
+    unsigned long long nodes = 0;
+    while (moves) {
+        int sq = Bitboard::pop_lsb(moves);
+        uint64_t flips = Bitboard::get_flips(P, O, sq);
+        nodes += perft_bitboard(O & ~flips, P | flips | (1ULL << sq), depth - 1, false);
+    }
+    return nodes;
+}
+
+unsigned long long run_engine(const std::string& engine, int depth) {
+    if (engine == "array") {
+        ArrayGame game;
+        return perft_api(game, 'X', depth, false);
+    }
+    if (engine == "game") {
+        Game game;
+        return perft_api(game, 'X', depth, false);
+    }
+    Game game;
+    return perft_bitboard(game.get_pieces('X'), game.get_pieces('O'), depth, false);
+}
+
+bool report(const std::string& engine, int depth) {
+    auto begin = std::chrono::steady_clock::now();
+    unsigned long long nodes = run_engine(engine, depth);
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - begin).count();
+
+    bool ok = true;
+    std::string verdict = "(no reference)";
+    if (depth <= MAX_KNOWN_DEPTH) {
+        ok = (nodes == KNOWN_PERFT[depth]);
+        verdict = ok ? "OK" : "MISMATCH (expected " + std::to_string(KNOWN_PERFT[depth]) + ")";
+    }
+
+    std::cout << std::left << std::setw(9) << engine
+              << " depth " << std::setw(2) << depth
+              << " nodes " << std::setw(14) << nodes
+              << std::fixed << std::setprecision(3)
+              << " time " << std::setw(8) << seconds << "s"
+              << std::setprecision(0)
+              << " " << std::setw(12) << (seconds > 0 ? nodes / seconds : 0.0) << " nodes/s  "
+              << verdict << "\n";
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 3) {
+        std::cout << "Usage: " << argv[0] << " [depth] [array|game|bitboard|all]\n";
+        return 1;
+    }
+
+    int depth = (argc >= 2) ? atoi(argv[1]) : 9;
+    std::string engine = (argc >= 3) ? argv[2] : "all";
+
+    if (depth < 1) {
+        std::cerr << "Depth must be at least 1\n";
+        return 1;
+    }
+    if (engine != "array" && engine != "game" && engine != "bitboard" && engine != "all") {
+        std::cerr << "Unknown engine: " << engine << "\n";
+        return 1;
+    }
+
+    bool ok = true;
+    const char* engines[] = {"array", "game", "bitboard"};
+    for (int i = 0; i < 3; i++) {
+        if (engine != "all" && engine != engines[i]) continue;
+        for (int d = 1; d <= depth; d++) {
+            ok = report(engines[i], d) && ok;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <string>
+#include <cstdint>
+
+// 二進位協定
+//
+// 連線後送出的第一個位元組若為 MAGIC (0x00) 就改用二進位協定；
+// 舊版客戶端一連上就送名字，不會以 0 開頭，所以兩種協定可以共用同一個 port。
+// 之後每則訊息為：
+//
+//   [type u8][length u16 little-endian][payload]
+//
+// 棋步為 1 byte（row * 8 + col）。雙方都保有自己的 Game：伺服器只送
+// 下了哪一步與接著輪到誰（MOVE），客戶端自己用 make_move 套用；
+// 完整盤面只有在客戶端要求重新同步（RESYNC）時才以 SNAPSHOT 送出。
+// 接收端的拆解見 frame.hpp 的 FrameReader。
+class Protocol {
+public:
+    static const uint8_t MAGIC = 0x00;
+    static const size_t HEADER_SIZE = 3;
+    static const size_t MAX_PAYLOAD = 1024;
+    // 名字最長幾個位元組：START、WATCH 都帶著名字，要遠小於 MAX_PAYLOAD
+    static const size_t MAX_NAME = 64;
+
+    enum Type {
+        // 客戶端 → 伺服器
+        C_HELLO = 0x01,              // 名字
+        C_MOVE = 0x02,               // [square]
+        C_RESYNC = 0x03,             // 要求完整盤面
+        C_WATCH = 0x04,              // 取代 HELLO：觀戰 [房間編號 u64]，省略時看觀眾最多的一局
+
+        // 伺服器 → 客戶端
+        S_WAIT = 0x10,               // 文字說明
+        S_START = 0x11,              // [我的棋子 'X'/'O'] + 對手名字；X 先下
+        S_MOVE = 0x12,               // [square][下的一方][接著輪到誰，終局為 '*']
+        S_PASS = 0x13,               // [被跳過的一方]
+        S_INVALID = 0x14,            // 文字原因
+        S_END = 0x15,                // 結果文字
+        S_SNAPSHOT = 0x16,           // [black u64][white u64][輪到誰]，little-endian
+        S_OPPONENT_DISCONNECT = 0x17,
+        S_WATCH = 0x18,              // [房間編號 u64] + 黑方名字 + ':' + 白方名字，接著是 SNAPSHOT
+        S_CLOCK = 0x19               // [黑方剩餘 ms u32][白方剩餘 ms u32]，計時對局每換手一次
+    };
+
+    // payload 超過 MAX_PAYLOAD 時回傳空字串：那樣的訊息接收端一定會斷線，不如不送
+    static std::string encode(uint8_t type, const std::string& payload) {
+        std::string out;
+        if (payload.size() > MAX_PAYLOAD) return out;
+        out.reserve(HEADER_SIZE + payload.size());
+        out += (char)type;
+        out += (char)(payload.size() & 0xFF);
+        out += (char)((payload.size() >> 8) & 0xFF);
+        out += payload;
+        return out;
+    }
+
+    static std::string encode(uint8_t type) {
+        return encode(type, std::string());
+    }
+
+    static std::string snapshot_payload(uint64_t black, uint64_t white, char to_move) {
+        std::string payload;
+        for (int i = 0; i < 8; i++) payload += (char)((black >> (8 * i)) & 0xFF);
+        for (int i = 0; i < 8; i++) payload += (char)((white >> (8 * i)) & 0xFF);
+        payload += to_move;
+        return payload;
+    }
+
+    // 把 SNAPSHOT 轉回 get_board_state() 格式的字串
+    static bool decode_snapshot(const char* payload, size_t size, std::string& state, char& to_move) {
+        if (size != 17) return false;
+        uint64_t black = 0, white = 0;
+        for (int i = 0; i < 8; i++) {
+            black |= (uint64_t)(uint8_t)payload[i] << (8 * i);
+            white |= (uint64_t)(uint8_t)payload[8 + i] << (8 * i);
+        }
+        state.assign(64, '*');
+        for (int sq = 0; sq < 64; sq++) {
+            if ((black >> sq) & 1) state[sq] = 'X';
+            else if ((white >> sq) & 1) state[sq] = 'O';
+        }
+        to_move = payload[16];
+        return true;
+    }
+};
+
+#endif // PROTOCOL_HPP
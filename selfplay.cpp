@@ -0,0 +1,247 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <sys/stat.h>
+#include "game.hpp"
+#include "engine.hpp"
+#include "eval.hpp"
+#include "training.hpp"
+
+// 自我對局：產生評估函式的訓練資料
+//
+// 每條執行緒一個 Engine，各自下完整的對局：前幾步隨機（每局的開局都不同），
+// 之後雙方以固定深度搜尋，剩下的空格不多時解到底，讓終局差盡量準確。
+// 每局的所有局面連同終局差寫進資料檔（格式見 training.hpp），一局寫一次。
+
+typedef std::chrono::steady_clock Clock;
+
+struct SelfPlayOptions {
+    int games;
+    int threads;
+    int depth;
+    int random_plies;           // 開局隨機下幾步（每局在 random_plies / 2 ~ random_plies 之間）
+    int exact;                  // 空格不超過此數時解到底
+    unsigned seed;
+};
+
+class SelfPlay {
+private:
+    const SelfPlayOptions& options;
+    FILE* out;
+    std::mutex out_mutex;
+    std::atomic<int> next_game;
+    std::atomic<int> finished;
+    std::atomic<unsigned long long> positions;
+    std::atomic<int> black_wins;
+    std::atomic<int> white_wins;
+    bool failed;
+
+    SelfPlay(const SelfPlay&);
+    SelfPlay& operator=(const SelfPlay&);
+
+    static int final_diff(const Game& game) {
+        int black = Bitboard::popcount(game.get_pieces('X'));
+        int white = Bitboard::popcount(game.get_pieces('O'));
+        int diff = black - white;
+        int empties = 64 - black - white;
+        if (diff > 0) diff += empties;
+        else if (diff < 0) diff -= empties;
+        return diff;
+    }
+
+    void play_one(Engine& engine, std::mt19937& rng, std::string& encoded) {
+        Game game;
+        char player = 'X';
+        std::vector<TrainingRecord> records;
+        int opening = options.random_plies / 2 + (int)(rng() % (options.random_plies / 2 + 1));
+        int ply = 0;
+        engine.clear();
+
+        while (true) {
+            if (!game.has_valid_moves(player)) {
+                player = (player == 'X') ? 'O' : 'X';
+                if (!game.has_valid_moves(player)) break;
+            }
+            TrainingRecord r = {game.get_pieces('X'), game.get_pieces('O'), player, 0};
+            records.push_back(r);
+
+            int sq;
+            if (ply < opening) {
+                uint64_t mask = game.get_move_mask(player);
+                int n = (int)(rng() % Bitboard::popcount(mask));
+                while (n-- > 0) mask &= mask - 1;
+                sq = __builtin_ctzll(mask);
+            } else {
+                int empties = 64 - Bitboard::popcount(game.get_pieces('X') | game.get_pieces('O'));
+                SearchResult best = engine.search(game, player, Clock::now() + std::chrono::hours(1),
+                                                  empties <= options.exact ? 60 : options.depth);
+                sq = best.row * 8 + best.col;
+            }
+            game.make_move(sq / 8, sq % 8, player);
+            player = (player == 'X') ? 'O' : 'X';
+            ply++;
+        }
+
+        int diff = final_diff(game);
+        if (diff > 0) black_wins++;
+        else if (diff < 0) white_wins++;
+        for (size_t i = 0; i < records.size(); i++) {
+            records[i].diff = diff;
+            TrainingFile::encode(records[i], encoded);
+        }
+        positions += records.size();
+    }
+
+    void run(int thread_index) {
+        Engine engine(new TranspositionTable(4));
+        std::mt19937 rng(options.seed * 7919 + thread_index);
+        std::string encoded;
+        while (next_game.fetch_add(1) < options.games) {
+            encoded.clear();
+            play_one(engine, rng, encoded);
+            {
+                std::lock_guard<std::mutex> lock(out_mutex);
+                if (fwrite(encoded.data(), 1, encoded.size(), out) != encoded.size()) failed = true;
+            }
+            finished++;
+        }
+        delete &engine.get_table();
+    }
+
+public:
+    SelfPlay(const SelfPlayOptions& o, FILE* f)
+        : options(o), out(f), next_game(0), finished(0), positions(0), black_wins(0), white_wins(0), failed(false) {}
+
+    bool run_all() {
+        std::vector<std::thread> workers;
+        for (int i = 0; i < options.threads; i++) {
+            workers.push_back(std::thread(&SelfPlay::run, this, i));
+        }
+
+        // 主執行緒每秒印一次進度
+        Clock::time_point begin = Clock::now();
+        int reported = 0;
+        while (finished.load() < options.games) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+            if ((int)elapsed > reported) {
+                reported = (int)elapsed;
+                std::cout << std::setw(5) << reported << "s  " << finished.load() << "/" << options.games
+                          << " games, " << positions.load() << " positions\n";
+            }
+        }
+        for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+
+        double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+        int games = finished.load();
+        std::cout << std::fixed << std::setprecision(1)
+                  << games << " games, " << positions.load() << " positions in " << elapsed << "s ("
+                  << games / elapsed << " games/s); X won " << black_wins.load()
+                  << ", O won " << white_wins.load() << ", " << games - black_wins.load() - white_wins.load()
+                  << " drawn\n";
+        return !failed;
+    }
+};
+
+static void usage(const char* prog) {
+    std::cout << "Usage: " << prog << " <output.bin> [options]\n"
+              << "  --games <n>     games to play (default 1000)\n"
+              << "  --threads <n>   games played in parallel (default: all cores)\n"
+              << "  --depth <n>     search depth per move (default 4)\n"
+              << "  --random <n>    random opening plies, each game uses n/2..n (default 10)\n"
+              << "  --exact <n>     solve to the end from this many empties (default 12)\n"
+              << "  --weights <file> evaluate with trained weights instead of the defaults\n"
+              << "  --seed <n>      random seed (default: time)\n"
+              << "Positions are appended to the output file.\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argv[1][0] == '-') {
+        usage(argv[0]);
+        return 1;
+    }
+    std::string path = argv[1];
+    std::string weights_path;
+    SelfPlayOptions options;
+    options.games = 1000;
+    options.threads = (int)std::thread::hardware_concurrency();
+    options.depth = 4;
+    options.random_plies = 10;
+    options.exact = 12;
+    options.seed = (unsigned)time(NULL);
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--games" && i + 1 < argc) {
+            options.games = atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (arg == "--depth" && i + 1 < argc) {
+            options.depth = atoi(argv[++i]);
+        } else if (arg == "--random" && i + 1 < argc) {
+            options.random_plies = atoi(argv[++i]);
+        } else if (arg == "--exact" && i + 1 < argc) {
+            options.exact = atoi(argv[++i]);
+        } else if (arg == "--weights" && i + 1 < argc) {
+            weights_path = argv[++i];
+        } else if (arg == "--seed" && i + 1 < argc) {
+            options.seed = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.threads < 1) options.threads = 1;
+    if (options.games < 1 || options.depth < 1 || options.random_plies < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (options.exact > Engine::ENDGAME_EMPTIES) options.exact = Engine::ENDGAME_EMPTIES;
+
+    // 用上一輪訓練出來的權重下，資料就會越來越接近好棋
+    WeightFile weights;
+    if (!weights_path.empty()) {
+        if (!weights.open(weights_path, Evaluator::instance())) {
+            std::cerr << "Cannot load weights " << weights_path << "\n";
+            return 1;
+        }
+        Evaluator::instance().set_weights(weights.weights());
+    }
+
+    // 已有資料時接在後面，但要確定是同一種檔案
+    struct stat st;
+    bool exists = stat(path.c_str(), &st) == 0 && st.st_size > 0;
+    if (exists) {
+        TrainingFile existing;
+        if (!existing.open(path)) {
+            std::cerr << path << " is not a self-play data file\n";
+            return 1;
+        }
+    }
+    FILE* out = fopen(path.c_str(), "ab");
+    if (!out) {
+        std::cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    if (!exists) fwrite(TrainingFile::magic(), 1, 8, out);
+
+    std::cout << "Self-play: " << options.games << " games on " << options.threads << " thread"
+              << (options.threads > 1 ? "s" : "") << ", depth " << options.depth << ", exact from "
+              << options.exact << " empties\n";
+    SelfPlay selfplay(options, out);
+    bool ok = selfplay.run_all();
+    if (fclose(out) != 0 || !ok) {
+        std::cerr << "Write to " << path << " failed\n";
+        return 1;
+    }
+    return 0;
+}
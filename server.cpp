@@ -1,249 +1,1831 @@
 #include <iostream>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
 #include <cstring>
+#include <cmath>
 #include <sys/socket.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
 #include <cstdlib>
 #include <ctime>
 #include "game.hpp"
+#include "book.hpp"
+#include "protocol.hpp"
+#include "frame.hpp"
+#include "output_queue.hpp"
+#include "histogram.hpp"
+#include "timing_wheel.hpp"
+#include "metrics.hpp"
+#include "archive.hpp"
+#include "ai_pool.hpp"
+#include "eval.hpp"
 
-#define BUFFER_SIZE 1024
+#define READ_BUFFER_SIZE 2048   // 最長的二進位訊息（3 + 1024 bytes）也放得下
+#define MAX_EVENTS 256
+
+// 記錄檔裡的名字要和登入的名字完全相同，接續對局時才認得出來
+static_assert(Protocol::MAX_NAME <= GameArchive::MAX_STRING, "archived names must not be truncated");
+
+// 輸出佇列的水位：超過 HIGH 視為慢速連線，暫停讀它的輸入，降回 LOW 以下才恢復；
+// 超過 LIMIT 或 SLOW_TIMEOUT 秒內沒降回 LOW 就直接斷線
+#define OUTPUT_HIGH_WATER (64 * 1024)
+#define OUTPUT_LOW_WATER (16 * 1024)
+#define OUTPUT_LIMIT (1024 * 1024)
+#define SLOW_TIMEOUT_MS 10000
+
+// 配對：積分分段寬度、每秒放寬多少、最多接受的差距；Elo 的初始值與 K 值
+#define RATING_BUCKET 50
+#define RATING_WIDEN_PER_SECOND 50
+#define MAX_RATING_WINDOW 1000
+#define INITIAL_RATING 1500
+#define ELO_K 32
+#define LOBBY_SWEEP_MS 250
+#define LOBBY_REPORT_SECONDS 10
+
+// 連上後這麼久還沒送名字就斷線
+#define LOGIN_TIMEOUT_MS 30000
+
+// 名字以此結尾時和電腦下；思考工作平均每個 worker 排超過這麼多個就不再接新的電腦對局
+#define AI_SUFFIX "@cpu"
+#define AI_QUEUE_PER_THREAD 8
+// 計時對局中電腦每步最多用掉剩餘時間的幾分之一
+#define AI_TIME_SHARE 20
+
+struct Room;
+class Reactor;
+
+// 計時器種類，owner 分別是 Connection 或 Room
+enum TimerKind { TIMER_LOGIN, TIMER_SLOW, TIMER_CLOCK };
+
+// 每步的時間控制：base 為 0 時不計時，輪到的一方只要 abandon 毫秒內有下就好
+struct TimeControl {
+    long long base_ms;          // 每人的總時間
+    long long increment_ms;     // Fischer：每下一步加回的時間；0 為 sudden death
+    long long abandon_ms;
+
+    bool timed() const { return base_ms > 0; }
+};
+
+// 電腦對手：pool 為 NULL 時不提供
+struct AiSettings {
+    AiPool* pool;
+    int move_ms;                // 每步的思考時間
+    bool ponder;                // 玩家思考時電腦先替玩家想
+};
+
+// 每條連線一個狀態機：等名字 → 大廳等配對 → 對局中，或一開始就要求觀戰
+// （HANDOFF：正要交給對手或房間所在的 reactor）
+struct Connection {
+    enum State { NAMING, LOBBY, HANDOFF, PLAYING, WATCHING };
+
+    uint64_t id;                // 全域唯一，fd 會被重複使用所以不能拿來比對
+    int fd;
+    State state;
+    std::string name;
+    int rating;                 // 登入時從大廳取得，配對用
+    FrameReader reader;
+    OutputQueue out;
+    bool binary;                // 第一個位元組為 Protocol::MAGIC 的連線
+    bool close_after_flush;     // 對局結束，送完剩下的訊息就關閉
+    bool closing;               // 已排入關閉佇列
+    bool slow;                  // 輸出佇列超過高水位，暫停處理輸入
+    bool bot;                   // 電腦對手的座位，沒有 socket，送給它的訊息直接丟掉
+    TimingWheel::Timer login_timer;
+    TimingWheel::Timer slow_timer;
+    Room* room;
+    int seat;                   // 在 room 中的位置（0 或 1）；觀戰者為在 spectators 中的位置
+
+    Connection(uint64_t i, int f)
+        : id(i), fd(f), state(NAMING), rating(INITIAL_RATING), reader(READ_BUFFER_SIZE), binary(false), close_after_flush(false), closing(false), slow(false), bot(false), room(NULL), seat(0) {
+        login_timer.owner = this;
+        login_timer.kind = TIMER_LOGIN;
+        slow_timer.owner = this;
+        slow_timer.kind = TIMER_SLOW;
+    }
+};
+
+// 一局棋：兩條連線共用一個 Game
+struct Room {
+    uint64_t id;
+    Connection* players[2];
+    std::string names[2];       // 玩家斷線後仍要拿來算積分
+    char pieces[2];
+    Game game;
+    int turn;                   // 輪到哪個座位
+    std::vector<Connection*> spectators;
+    long long remaining_ms[2];  // 各座位剩下的時間
+    uint64_t turn_started_ms;
+    TimingWheel::Timer clock;   // 輪到的一方超時就判負
+    bool vs_ai;                 // 其中一方是電腦：不計積分、不寫對局記錄
+    int plies;                  // 已下的步數，用來認出過時的電腦思考結果
+    int ai_worker;              // 上一步是哪個 AiPool worker 想的，置換表在那裡；-1 為還沒有
+};
+
+static void log_line(const std::string& line) {
+    std::cout << line + "\n";    // 一次寫出整行，避免多個 reactor 的輸出交錯
+}
+
+static uint64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 所有 reactor 共用的大廳，依積分分段配對
+//
+// 積分每 RATING_BUCKET 分一段。新玩家先看自己這一段，再往兩側一段一段找，
+// 能接受的差距由等最久的一方決定，隨等待時間從 RATING_BUCKET 放寬到 MAX_RATING_WINDOW。
+// 同一段一定配得成，所以每段最多只有一位等待者，配對只需要看固定數量的段。
+// 沒有新玩家進來時，各 reactor 定期呼叫 sweep() 讓放寬後的等待者互相配對。
+//
+// 這是唯一需要上鎖的地方，每位玩家只在登入、配對與對局結束時進來。
+class Lobby {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Ticket {
+        Reactor* reactor;
+        int fd;
+        uint64_t id;
+        int rating;
+        Clock::time_point since;
+    };
 
-class Server {
 private:
-    int server_fd;
-    int client_sockets[2];
-    std::string player_names[2];
-    char player_pieces[2];
-    Game* game;
-    int current_turn;
-    
-    void send_message(int client_idx, const std::string& msg) {
-        std::string msg_with_newline = msg + "\n";
-        send(client_sockets[client_idx], msg_with_newline.c_str(), msg_with_newline.length(), 0);
-    }
-    
-    std::string receive_message(int client_idx) {
-        char buffer[BUFFER_SIZE] = {0};
-        int valread = read(client_sockets[client_idx], buffer, BUFFER_SIZE);
-        if (valread <= 0) {
-            return "";
-        }
-        return std::string(buffer);
-    }
-    
-    bool check_client_connected(int client_idx) {
-        fd_set read_fds;
-        struct timeval tv;
-        FD_ZERO(&read_fds);
-        FD_SET(client_sockets[client_idx], &read_fds);
-        
-        tv.tv_sec = 0;
-        tv.tv_usec = 0;
-        
-        int result = select(client_sockets[client_idx] + 1, &read_fds, NULL, NULL, &tv);
-        
-        if (result > 0) {
-            char buffer[1];
-            int n = recv(client_sockets[client_idx], buffer, 1, MSG_PEEK | MSG_DONTWAIT);
-            if (n == 0) {
+    static const int BUCKETS = 64;
+
+    std::mutex mutex;
+    bool occupied[BUCKETS];
+    Ticket slots[BUCKETS];
+    std::unordered_map<uint64_t, int> bucket_of;        // 連線編號 → 所在的段
+    std::unordered_map<std::string, int> ratings;       // 依名字記的 Elo，只存在記憶體
+    Histogram wait_us;                                  // 從進大廳到配對成功
+    uint64_t pairs;
+    Clock::time_point report_since;
+
+    static int bucket(int rating) {
+        int b = rating / RATING_BUCKET;
+        return b < 0 ? 0 : (b >= BUCKETS ? BUCKETS - 1 : b);
+    }
+
+    static int window(const Ticket& t, Clock::time_point now) {
+        long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - t.since).count();
+        long long w = RATING_BUCKET + ms * RATING_WIDEN_PER_SECOND / 1000;
+        return w > MAX_RATING_WINDOW ? MAX_RATING_WINDOW : (int)w;
+    }
+
+    void take(int b, Ticket& out, Clock::time_point now) {
+        out = slots[b];
+        occupied[b] = false;
+        bucket_of.erase(out.id);
+        wait_us.record(std::chrono::duration_cast<std::chrono::microseconds>(now - out.since).count());
+    }
+
+    // 在 b 兩側 distance 段內找等待者，近的優先；找到就取走
+    bool take_nearest(int b, int max_distance, Ticket& partner, Clock::time_point now) {
+        for (int d = 1; d <= max_distance; d++) {
+            int lo = b - d, hi = b + d;
+            if (lo < 0 && hi >= BUCKETS) break;
+            if (lo >= 0 && occupied[lo]) { take(lo, partner, now); return true; }
+            if (hi < BUCKETS && occupied[hi]) { take(hi, partner, now); return true; }
+        }
+        return false;
+    }
+
+public:
+    Lobby() : pairs(0), report_since(Clock::now()) {
+        memset(occupied, 0, sizeof(occupied));
+    }
+
+    int rating(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unordered_map<std::string, int>::const_iterator it = ratings.find(name);
+        return it != ratings.end() ? it->second : INITIAL_RATING;
+    }
+
+    // 有合適的等待者就取走他（回傳 true），否則自己成為等待者
+    bool join(Ticket me, Ticket& partner) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Clock::time_point now = Clock::now();
+        me.since = now;
+        int b = bucket(me.rating);
+
+        if (occupied[b]) {
+            take(b, partner, now);
+        } else {
+            // 新來的人還沒等，能不能配由對方等了多久決定；每段只要看一次
+            bool found = false;
+            for (int d = 1; d * RATING_BUCKET <= MAX_RATING_WINDOW && !found; d++) {
+                int side[2] = {b - d, b + d};
+                for (int i = 0; i < 2 && !found; i++) {
+                    int o = side[i];
+                    if (o < 0 || o >= BUCKETS || !occupied[o]) continue;
+                    if (d * RATING_BUCKET <= window(slots[o], now)) {
+                        take(o, partner, now);
+                        found = true;
+                    }
+                }
+            }
+            if (!found) {
+                slots[b] = me;
+                occupied[b] = true;
+                bucket_of[me.id] = b;
                 return false;
             }
         }
-        
+        wait_us.record(0);
+        pairs++;
         return true;
     }
-    
+
+    void leave(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unordered_map<uint64_t, int>::iterator it = bucket_of.find(id);
+        if (it == bucket_of.end()) return;
+        occupied[it->second] = false;
+        bucket_of.erase(it);
+    }
+
+    // 替 reactor 自己的等待者找放寬後配得到的對手；回傳 (自己的, 對手) 配對
+    void sweep(Reactor* reactor, std::vector<std::pair<Ticket, Ticket> >& matched) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Clock::time_point now = Clock::now();
+        for (int b = 0; b < BUCKETS; b++) {
+            if (!occupied[b] || slots[b].reactor != reactor) continue;
+            int reach = window(slots[b], now) / RATING_BUCKET;
+            Ticket partner;
+            if (!take_nearest(b, reach, partner, now)) continue;
+            Ticket mine;
+            take(b, mine, now);
+            pairs++;
+            matched.push_back(std::make_pair(mine, partner));
+        }
+    }
+
+    // 對局結束後更新雙方的 Elo；score 為 a 的得分（1 勝、0.5 和、0 負）
+    void record_result(const std::string& a, const std::string& b, double score) {
+        std::lock_guard<std::mutex> lock(mutex);
+        int ra = ratings.count(a) ? ratings[a] : INITIAL_RATING;
+        int rb = ratings.count(b) ? ratings[b] : INITIAL_RATING;
+        double expected = 1.0 / (1.0 + pow(10.0, (rb - ra) / 400.0));
+        int delta = (int)lround(ELO_K * (score - expected));
+        ratings[a] = ra + delta;
+        ratings[b] = rb - delta;
+    }
+
+    // 上次回報之後的配對數與等待時間分佈；沒有配對時回傳空字串
+    std::string report() {
+        std::lock_guard<std::mutex> lock(mutex);
+        Clock::time_point now = Clock::now();
+        double seconds = std::chrono::duration<double>(now - report_since).count();
+        std::string line;
+        if (pairs > 0) {
+            std::ostringstream ss;
+            ss.setf(std::ios::fixed);
+            ss.precision(1);
+            ss << "Lobby: " << pairs << " pairs (" << pairs / seconds << "/s), wait ms"
+               << " p50 " << wait_us.percentile(50) / 1000.0
+               << " p90 " << wait_us.percentile(90) / 1000.0
+               << " p99 " << wait_us.percentile(99) / 1000.0
+               << " max " << wait_us.max() / 1000.0
+               << ", " << bucket_of.size() << " waiting";
+            line = ss.str();
+        }
+        pairs = 0;
+        wait_us.clear();
+        report_since = now;
+        return line;
+    }
+};
+
+// 所有 reactor 的房間清單：觀戰者可能連到別的 reactor，要靠這裡找到房間在哪
+class RoomDirectory {
+private:
+    struct Entry {
+        Reactor* reactor;
+        size_t spectators;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Entry> rooms;
+
 public:
-    Server() {
-        server_fd = -1;
-        client_sockets[0] = -1;
-        client_sockets[1] = -1;
-        game = new Game();
-        current_turn = 0;
-    }
-    
-    ~Server() {
-        if (game) delete game;
-        if (client_sockets[0] != -1) close(client_sockets[0]);
-        if (client_sockets[1] != -1) close(client_sockets[1]);
+    void add(uint64_t id, Reactor* reactor) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry e = {reactor, 0};
+        rooms[id] = e;
+    }
+
+    void remove(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        rooms.erase(id);
+    }
+
+    void adjust_spectators(uint64_t id, int delta) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unordered_map<uint64_t, Entry>::iterator it = rooms.find(id);
+        if (it != rooms.end()) it->second.spectators += delta;
+    }
+
+    // id 為 0 時挑觀眾最多的一局（同樣多取最新的）
+    bool find(uint64_t& id, Reactor*& reactor) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (id != 0) {
+            std::unordered_map<uint64_t, Entry>::const_iterator it = rooms.find(id);
+            if (it == rooms.end()) return false;
+            reactor = it->second.reactor;
+            return true;
+        }
+        bool found = false;
+        size_t best = 0;
+        for (std::unordered_map<uint64_t, Entry>::const_iterator it = rooms.begin(); it != rooms.end(); ++it) {
+            if (!found || it->second.spectators > best ||
+                (it->second.spectators == best && it->first > id)) {
+                id = it->first;
+                reactor = it->second.reactor;
+                best = it->second.spectators;
+                found = true;
+            }
+        }
+        return found;
+    }
+};
+
+// 重新啟動時從對局記錄找回的未完成對局：雙方用原本的名字登入後接著下。
+// 先到的一方在這裡等，等到對手之後和大廳配對一樣交給同一個 reactor。
+// 同一個名字出現在多局未完成的對局裡時，只接得回最後開始的那一局。
+class ResumeTable {
+public:
+    enum Claim { NONE, WAIT, MATCHED };
+
+private:
+    struct Entry {
+        ArchivedGame game;
+        bool waiting;
+        int waiting_seat;
+        Lobby::Ticket waiter;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Entry> games;
+    std::unordered_map<std::string, uint64_t> by_name;
+
+public:
+    void add(const ArchivedGame& game) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry e;
+        e.game = game;
+        e.waiting = false;
+        e.waiting_seat = 0;
+        games[game.id] = e;
+        by_name[game.names[0]] = game.id;
+        by_name[game.names[1]] = game.id;
+    }
+
+    // name 有未完成的對局時，對手已經在等就回傳 MATCHED 並把對局交給呼叫端，否則登記等待
+    Claim claim(const std::string& name, const Lobby::Ticket& me, Lobby::Ticket& partner, ArchivedGame& game) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unordered_map<std::string, uint64_t>::iterator n = by_name.find(name);
+        if (n == by_name.end()) return NONE;
+        std::unordered_map<uint64_t, Entry>::iterator it = games.find(n->second);
+        if (it == games.end()) return NONE;
+        Entry& e = it->second;
+
+        int seat = (e.game.names[0] == name) ? 0 : 1;
+        if (!e.waiting) {
+            e.waiting = true;
+            e.waiting_seat = seat;
+            e.waiter = me;
+            return WAIT;
+        }
+        // 雙方同名時先到的坐 X；否則同一個名字重複登入，當作一般玩家
+        if (e.waiting_seat == seat && (seat == 1 || e.game.names[0] != e.game.names[1])) return NONE;
+
+        partner = e.waiter;
+        game = e.game;
+        for (int i = 0; i < 2; i++) {
+            std::unordered_map<std::string, uint64_t>::iterator m = by_name.find(e.game.names[i]);
+            if (m != by_name.end() && m->second == e.game.id) by_name.erase(m);
+        }
+        games.erase(it);
+        return MATCHED;
+    }
+
+    // 等待中的一方斷線
+    void leave(uint64_t conn_id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::unordered_map<uint64_t, Entry>::iterator it = games.begin(); it != games.end(); ++it) {
+            if (it->second.waiting && it->second.waiter.id == conn_id) {
+                it->second.waiting = false;
+                return;
+            }
+        }
+    }
+};
+
+// 一個 reactor 一條執行緒：自己的監聽 socket（SO_REUSEPORT）、epoll 與房間表。
+// 同一局的兩位玩家一定由同一個 reactor 處理，所以對局中完全不用上鎖；
+// 配對到別的 reactor 的玩家時，把連線透過 inbox + eventfd 交過去。
+class Reactor {
+private:
+    struct Handoff {
+        Connection* conn;
+        int partner_fd;
+        uint64_t partner_id;
+        uint64_t room_id;               // 不為 0 時是要觀戰這一局
+        ArchivedGame* resume;           // 不為 NULL 時是接續這一局（由收到的一方釋放）
+    };
+
+    // AiPool 的 worker 想好的一步；square 為 -1 代表沒有合法步
+    struct AiMove {
+        uint64_t room_id;
+        int ply;
+        int square;
+        int worker;
+    };
+
+    Lobby& lobby;
+    RoomDirectory& directory;
+    ResumeTable& resumes;
+    GameArchive* archive;               // 沒有 --archive 時為 NULL
+    const AiSettings& ai;
+    std::atomic<uint64_t>& next_id;     // 連線與房間編號，所有 reactor 共用
+    int index;
+    bool verbose;
+    int server_fd;
+    int epoll_fd;
+    int wakeup_fd;                      // eventfd，有新的 Handoff 時叫醒
+    std::mutex inbox_mutex;
+    std::vector<Handoff> inbox;
+    std::vector<AiMove> ai_moves;       // 和 inbox 共用 mutex 與 eventfd
+    std::unordered_map<int, Connection*> connections;
+    std::unordered_map<uint64_t, Room*> rooms;
+    std::vector<Connection*> pending_close;
+    std::vector<Connection*> pending_resume;   // 降回低水位、要補讀輸入的連線
+    std::vector<std::pair<Reactor*, Handoff> > pending_handoff;
+    std::vector<Connection*> dead;       // 這一輪事件處理完才釋放，避免事件指到已刪除的連線
+    uint64_t reported_moves;             // 上次回報時的對局記錄統計
+    uint64_t reported_syncs;
+    std::mt19937 rng;
+    const TimeControl& time_control;
+    TimingWheel wheel;                   // 登入逾時、慢速連線與對局時鐘
+    MetricsShard& metrics;               // 只有這條執行緒會寫
+
+    Reactor(const Reactor&);
+    Reactor& operator=(const Reactor&);
+
+    void send_message(Connection* c, const std::string& msg) {
+        enqueue(c, msg + "\n");
+    }
+
+    void send_frame(Connection* c, uint8_t type, const std::string& payload) {
+        enqueue(c, Protocol::encode(type, payload));
+    }
+
+    // 同一件事依連線使用的協定送出文字或二進位訊息
+    void send_either(Connection* c, const std::string& text, uint8_t type, const std::string& payload) {
+        if (c->binary) {
+            send_frame(c, type, payload);
+        } else {
+            send_message(c, text);
+        }
+    }
+
+    void enqueue(Connection* c, const std::string& data) {
+        if (c->closing || c->bot) return;
+        enqueue(c, std::make_shared<const std::string>(data));
+    }
+
+    // 送給房間裡所有觀戰者：每種協定只編碼一次，所有人共用同一塊緩衝
+    void broadcast(Room* room, const std::string& text, uint8_t type, const std::string& payload) {
+        OutputQueue::Buffer text_buf, frame_buf;
+        for (size_t i = 0; i < room->spectators.size(); i++) {
+            Connection* s = room->spectators[i];
+            if (s->binary) {
+                if (!frame_buf) frame_buf = std::make_shared<const std::string>(Protocol::encode(type, payload));
+                enqueue(s, frame_buf);
+            } else {
+                if (!text_buf) text_buf = std::make_shared<const std::string>(text + "\n");
+                enqueue(s, text_buf);
+            }
+        }
+    }
+
+    // 排進輸出佇列後馬上試著寫；對方一直不收就斷線，不讓佇列無限成長
+    void enqueue(Connection* c, const OutputQueue::Buffer& data) {
+        if (c->closing || c->bot || data->empty()) return;
+        c->out.push(data);
+        metrics.queued_bytes.add(data->size());
+        if (c->out.size() > OUTPUT_LIMIT) {
+            drop_slow_consumer(c);
+            return;
+        }
+        flush(c);
+    }
+
+    // 盡量把輸出佇列寫出去；寫不完的等 EPOLLOUT 再寫
+    void flush(Connection* c) {
+        if (c->closing || c->bot) return;
+        size_t before = c->out.size();
+        OutputQueue::WriteResult r = c->out.write_to(c->fd);
+        metrics.bytes_sent.add(before - c->out.size());
+        metrics.queued_bytes.sub(before - c->out.size());
+        if (r == OutputQueue::WRITE_ERROR) {
+            schedule_close(c);
+            return;
+        }
+        if (c->out.empty() && c->close_after_flush) {
+            schedule_close(c);
+            return;
+        }
+
+        size_t queued = c->out.size();
+        if (!c->slow && queued >= OUTPUT_HIGH_WATER) {
+            c->slow = true;
+            wheel.schedule(&c->slow_timer, now_ms() + SLOW_TIMEOUT_MS);
+            if (verbose) log_line(c->name + " is slow, pausing input (" + std::to_string(queued) + " bytes queued)");
+        } else if (c->slow && queued <= OUTPUT_LOW_WATER) {
+            c->slow = false;
+            wheel.cancel(&c->slow_timer);
+            // edge-triggered：暫停期間沒讀的輸入不會再通知，這一輪結束後補讀
+            pending_resume.push_back(c);
+        }
+    }
+
+    void drop_slow_consumer(Connection* c) {
+        log_line("Dropping slow consumer " + c->name + " (" + std::to_string(c->out.size()) + " bytes queued)");
+        metrics.slow_consumers_dropped.add();
+        metrics.queued_bytes.sub(c->out.size());
+        c->out.clear();
+        schedule_close(c);
+    }
+
+    void schedule_close(Connection* c) {
+        if (c->closing) return;
+        c->closing = true;
+        pending_close.push_back(c);
+    }
+
+    // 真正關閉連線；對局中斷線時通知對手
+    void close_connection(Connection* c) {
+        wheel.cancel(&c->login_timer);
+        wheel.cancel(&c->slow_timer);
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        connections.erase(c->fd);
+        metrics.connections_closed.add();
+        metrics.queued_bytes.sub(c->out.size());
+        c->out.clear();
+
+        Room* room = c->room;
+        if (c->state == Connection::WATCHING) {
+            if (room) leave_room(c);
+        } else if (room) {
+            c->room = NULL;
+            room->players[c->seat] = NULL;
+            Connection* other = room->players[1 - c->seat];
+            log_line(room_prefix(room) + c->name + " disconnected");
+            // 中途離開算輸
+            if (!room->vs_ai) lobby.record_result(room->names[c->seat], room->names[1 - c->seat], 0.0);
+            if (other) send_either(other, "OPPONENT_DISCONNECT:", Protocol::S_OPPONENT_DISCONNECT, "");
+            std::string result = c->name + " disconnected";
+            if (archive && !room->vs_ai) archive->end(room->id, result);
+            broadcast(room, "END:" + result + ":" + room->game.get_board_state(), Protocol::S_END, result);
+            finish_room(room);
+        } else if (c->state == Connection::LOBBY) {
+            lobby.leave(c->id);
+            resumes.leave(c->id);
+            log_line(c->name + " left the lobby");
+        }
+        dead.push_back(c);
+    }
+
+    void process_closes() {
+        for (size_t i = 0; i < pending_close.size(); i++) {
+            close_connection(pending_close[i]);
+        }
+        pending_close.clear();
+    }
+
+    void process_resumes() {
+        while (!pending_resume.empty()) {
+            std::vector<Connection*> resumed;
+            resumed.swap(pending_resume);
+            for (size_t i = 0; i < resumed.size(); i++) {
+                Connection* c = resumed[i];
+                if (!c->closing && !c->slow && c->state != Connection::HANDOFF) handle_read(c);
+            }
+        }
+    }
+
+    // 這一輪事件處理完之後才把連線交出去，交出後這條執行緒不能再碰它
+    void process_handoffs() {
+        for (size_t i = 0; i < pending_handoff.size(); i++) {
+            pending_handoff[i].first->post(pending_handoff[i].second);
+        }
+        pending_handoff.clear();
+    }
+
+    // 其他 reactor 交過來的連線
+    void drain_inbox() {
+        uint64_t count;
+        while (read(wakeup_fd, &count, sizeof(count)) > 0) {}
+
+        std::vector<Handoff> received;
+        std::vector<AiMove> moves;
+        {
+            std::lock_guard<std::mutex> lock(inbox_mutex);
+            received.swap(inbox);
+            moves.swap(ai_moves);
+        }
+        for (size_t i = 0; i < moves.size(); i++) {
+            play_ai_move(moves[i]);
+        }
+        for (size_t i = 0; i < received.size(); i++) {
+            Connection* c = received[i].conn;
+            if (!watch(c)) {
+                close(c->fd);
+                metrics.connections_closed.add();
+                metrics.queued_bytes.sub(c->out.size());
+                delete c;
+                continue;
+            }
+            if (c->slow) wheel.schedule(&c->slow_timer, now_ms() + SLOW_TIMEOUT_MS);
+            if (received[i].room_id != 0) {
+                std::unordered_map<uint64_t, Room*>::iterator room = rooms.find(received[i].room_id);
+                if (room != rooms.end()) {
+                    join_room(c, room->second);
+                } else {
+                    reject_spectator(c);     // 交接途中那一局結束了
+                }
+                continue;
+            }
+            c->state = Connection::LOBBY;
+
+            std::unordered_map<int, Connection*>::iterator it = connections.find(received[i].partner_fd);
+            Connection* partner = (it != connections.end()) ? it->second : NULL;
+            if (partner && partner->id == received[i].partner_id &&
+                partner->state == Connection::LOBBY && !partner->closing) {
+                start_room(partner, c, received[i].resume);
+            } else {
+                // 對手在交接途中離開了，重新排隊
+                requeue(c, received[i].resume);
+            }
+            delete received[i].resume;
+            // 交接期間收到的資料（或斷線）用 edge-triggered 加入時的初始事件處理
+        }
+    }
+
+    // 準備把連線交給別的 reactor：計時器在這個 reactor 的輪上，要先取消
+    void detach(Connection* c) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+        connections.erase(c->fd);
+        wheel.cancel(&c->login_timer);
+        wheel.cancel(&c->slow_timer);
+        c->state = Connection::HANDOFF;
+    }
+
+    bool watch(Connection* c) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = c;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->fd, &ev) < 0) return false;
+        connections[c->fd] = c;
+        return true;
+    }
+
+    std::string room_prefix(const Room* room) const {
+        std::ostringstream ss;
+        ss << "[room " << room->id << "] ";
+        return ss.str();
+    }
+
+    // 對局結束：剩下的玩家送完訊息後斷線（與舊版 server 結束時相同）
+    void finish_room(Room* room) {
+        if (room->vs_ai) ai.pool->stop_ponder(room->ai_worker, room->id);
+        for (int i = 0; i < 2; i++) {
+            Connection* p = room->players[i];
+            if (!p) continue;
+            if (p->bot) {
+                delete p;
+                continue;
+            }
+            p->room = NULL;
+            p->close_after_flush = true;
+            flush(p);
+        }
+        for (size_t i = 0; i < room->spectators.size(); i++) {
+            Connection* s = room->spectators[i];
+            s->room = NULL;
+            s->close_after_flush = true;
+            flush(s);
+        }
+        metrics.spectators_left.add(room->spectators.size());
+        metrics.rooms_finished.add();
+        wheel.cancel(&room->clock);
+        directory.remove(room->id);
+        rooms.erase(room->id);
+        delete room;
+    }
+
+    void accept_clients() {
+        while (true) {
+            struct sockaddr_in address;
+            socklen_t addrlen = sizeof(address);
+            int fd = accept4(server_fd, (struct sockaddr*)&address, &addrlen, SOCK_NONBLOCK);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    std::cerr << "Accept failed: " << strerror(errno) << "\n";
+                }
+                return;
+            }
+
+            // 棋步訊息很小，不要等 Nagle 合併
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            Connection* c = new Connection(next_id.fetch_add(1), fd);
+            if (!watch(c)) {
+                close(fd);
+                delete c;
+                continue;
+            }
+            metrics.connections_opened.add();
+            wheel.schedule(&c->login_timer, now_ms() + LOGIN_TIMEOUT_MS);
+        }
+    }
+
+    // edge-triggered：一次讀到 EAGAIN 為止；緩衝滿了就先處理再繼續讀。
+    // 慢速連線先不讀，讓 TCP 的接收視窗把對方擋住
+    void handle_read(Connection* c) {
+        while (!c->slow) {
+            FrameReader::ReadResult r = c->reader.read_from(c->fd);
+            process_input(c);
+            if (c->closing || c->state == Connection::HANDOFF) return;
+
+            if (r == FrameReader::READ_FULL) {
+                if (c->slow) return;       // 緩衝裡的資料等恢復後再處理
+                if (c->reader.full()) {
+                    schedule_close(c);     // 一則訊息比緩衝還長
+                    return;
+                }
+                continue;
+            }
+            if (r == FrameReader::READ_EOF || r == FrameReader::READ_ERROR) {
+                schedule_close(c);
+            }
+            // 已經交給別的 reactor 的連線由對方發現斷線
+            return;
+        }
+    }
+
+    void process_input(Connection* c) {
+        if (c->state == Connection::NAMING && !c->binary && c->reader.peek() == Protocol::MAGIC) {
+            c->binary = true;
+            c->reader.skip(1);
+        }
+        if (c->binary) {
+            process_frames(c);
+        } else {
+            process_lines(c);
+        }
+    }
+
+    void process_frames(Connection* c) {
+        uint8_t type;
+        Slice payload;
+        while (!c->closing && c->state != Connection::HANDOFF) {
+            int r = c->reader.next_frame(type, payload);
+            if (r == 0) break;
+            if (r < 0) {
+                schedule_close(c);
+                break;
+            }
+            handle_frame(c, type, payload);
+        }
+    }
+
+    // 以換行分割訊息；舊版客戶端送名字和棋步時不加換行，
+    // 所以緩衝裡沒有換行時，把這次收到的資料整段當成一則訊息
+    void process_lines(Connection* c) {
+        Slice line;
+        while (!c->closing && c->state != Connection::HANDOFF &&
+               (c->reader.next_line(line) || c->reader.take_rest(line))) {
+            if (line.empty()) continue;
+            handle_message(c, line);
+        }
+    }
+
+    void handle_message(Connection* c, const Slice& msg) {
+        switch (c->state) {
+        case Connection::NAMING:
+            if (msg.size >= 5 && memcmp(msg.data, "WATCH", 5) == 0 && (msg.size == 5 || msg[5] == ':')) {
+                uint64_t id = (msg.size > 6) ? strtoull(Slice(msg.data + 6, msg.size - 6).str().c_str(), NULL, 10) : 0;
+                spectate(c, id);
+            } else {
+                login(c, msg.str());
+            }
+            break;
+        case Connection::LOBBY:
+        case Connection::HANDOFF:
+        case Connection::WATCHING:
+            // 還沒開局或只是觀戰，忽略
+            break;
+        case Connection::PLAYING:
+            handle_move(c, msg);
+            break;
+        }
+    }
+
+    void handle_frame(Connection* c, uint8_t type, const Slice& payload) {
+        switch (type) {
+        case Protocol::C_HELLO:
+            if (c->state != Connection::NAMING) break;
+            login(c, payload.str());
+            break;
+        case Protocol::C_WATCH:
+            if (c->state != Connection::NAMING) break;
+            if (payload.size == 8) {
+                uint64_t id = 0;
+                for (int i = 0; i < 8; i++) id |= (uint64_t)(uint8_t)payload[i] << (8 * i);
+                spectate(c, id);
+            } else {
+                spectate(c, 0);
+            }
+            break;
+        case Protocol::C_MOVE:
+            if (c->state != Connection::PLAYING) break;
+            if (payload.size != 1 || (uint8_t)payload[0] >= 64) {
+                metrics.invalid_moves.add();
+                send_frame(c, Protocol::S_INVALID, "Invalid position format");
+                break;
+            }
+            metrics.parse.observe(0);       // 二進位棋步不用解析
+            play_move(c, (uint8_t)payload[0] / 8, (uint8_t)payload[0] % 8);
+            break;
+        case Protocol::C_RESYNC:
+            if (c->room) {
+                Room* room = c->room;
+                send_frame(c, Protocol::S_SNAPSHOT,
+                           Protocol::snapshot_payload(room->game.get_pieces('X'), room->game.get_pieces('O'),
+                                                      room->pieces[room->turn]));
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // 觀戰：room_id 為 0 時看觀眾最多的一局；房間在別的 reactor 就把連線交過去
+    void spectate(Connection* c, uint64_t room_id) {
+        wheel.cancel(&c->login_timer);
+        c->name = "spectator";
+        c->state = Connection::WATCHING;
+        Reactor* owner = NULL;
+        if (!directory.find(room_id, owner)) {
+            reject_spectator(c);
+            return;
+        }
+        if (owner == this) {
+            std::unordered_map<uint64_t, Room*>::iterator it = rooms.find(room_id);
+            if (it != rooms.end()) {
+                join_room(c, it->second);
+            } else {
+                reject_spectator(c);
+            }
+            return;
+        }
+
+        detach(c);
+        Handoff h = {c, -1, 0, room_id, NULL};
+        pending_handoff.push_back(std::make_pair(owner, h));
+    }
+
+    void reject_spectator(Connection* c) {
+        c->state = Connection::WATCHING;
+        send_either(c, "INVALID:No such game", Protocol::S_INVALID, "No such game");
+        c->close_after_flush = true;
+        flush(c);
+    }
+
+    // 先單獨送出目前盤面，之後跟著 broadcast 收每一步
+    void join_room(Connection* c, Room* room) {
+        c->state = Connection::WATCHING;
+        c->room = room;
+        c->seat = (int)room->spectators.size();
+        room->spectators.push_back(c);
+        directory.adjust_spectators(room->id, 1);
+        metrics.spectators_joined.add();
+
+        // login 已經限制名字長度；這裡再截一次，確保 WATCH 訊息不會超過 MAX_PAYLOAD
+        int x = (room->pieces[0] == 'X') ? 0 : 1;
+        std::string names = room->names[x].substr(0, Protocol::MAX_NAME) + ":" +
+                            room->names[1 - x].substr(0, Protocol::MAX_NAME);
+        std::string id_bytes;
+        for (int i = 0; i < 8; i++) id_bytes += (char)((room->id >> (8 * i)) & 0xFF);
+        char to_move = room->pieces[room->turn];
+        if (c->binary) {
+            send_frame(c, Protocol::S_WATCH, id_bytes + names);
+            send_frame(c, Protocol::S_SNAPSHOT,
+                       Protocol::snapshot_payload(room->game.get_pieces('X'), room->game.get_pieces('O'), to_move));
+        } else {
+            send_message(c, "WATCH:" + std::to_string(room->id) + ":" + names);
+            send_message(c, "BOARD:" + room->game.get_board_state() + ":" + to_move);
+        }
+        if (verbose) log_line(room_prefix(room) + "spectator joined (" + std::to_string(room->spectators.size()) + " watching)");
+    }
+
+    // 把觀戰者從房間移除：和最後一位交換位置，O(1)
+    void leave_room(Connection* c) {
+        Room* room = c->room;
+        Connection* last = room->spectators.back();
+        room->spectators[c->seat] = last;
+        last->seat = c->seat;
+        room->spectators.pop_back();
+        c->room = NULL;
+        directory.adjust_spectators(room->id, -1);
+        metrics.spectators_left.add();
+    }
+
+    void login(Connection* c, const std::string& name) {
+        wheel.cancel(&c->login_timer);
+        // 名字會原樣放進對手與觀戰者收到的訊息，太長的二進位訊息對方會拒收
+        if (name.size() > Protocol::MAX_NAME) {
+            std::string reason = "Name too long (at most " + std::to_string(Protocol::MAX_NAME) + " bytes)";
+            send_either(c, "INVALID:" + reason, Protocol::S_INVALID, reason);
+            c->close_after_flush = true;
+            flush(c);
+            return;
+        }
+        size_t suffix = strlen(AI_SUFFIX);
+        if (name.size() > suffix && name.compare(name.size() - suffix, suffix, AI_SUFFIX) == 0) {
+            c->name = name.substr(0, name.size() - suffix);
+            play_computer(c);
+            return;
+        }
+        c->name = name;
+        c->rating = lobby.rating(name);
+        log_line("Player connected: " + c->name + " (" + std::to_string(c->rating) + ")");
+        if (!resume(c)) join_lobby(c);
+    }
+
+    // 上次伺服器停止時 c 有下到一半的對局就接著下；沒有時回傳 false
+    bool resume(Connection* c) {
+        Lobby::Ticket me = {this, c->fd, c->id, c->rating, Lobby::Clock::time_point()};
+        Lobby::Ticket partner;
+        ArchivedGame game;
+        switch (resumes.claim(c->name, me, partner, game)) {
+        case ResumeTable::NONE:
+            return false;
+        case ResumeTable::WAIT:
+            c->state = Connection::LOBBY;
+            send_either(c, "WAIT:Waiting for your opponent to reconnect...",
+                        Protocol::S_WAIT, "Waiting for your opponent to reconnect...");
+            return true;
+        case ResumeTable::MATCHED:
+            c->state = Connection::LOBBY;
+            pair_with(c, partner, &game);
+            return true;
+        }
+        return false;
+    }
+
+    // 和電腦下：電腦佔一個沒有 socket 的座位，思考交給 AiPool；
+    // 工作池忙不過來時不開新局，避免已經在下的電腦對局越來越慢
+    void play_computer(Connection* c) {
+        c->state = Connection::PLAYING;
+        if (!ai.pool || ai.pool->queue_depth() >= (uint64_t)ai.pool->threads() * AI_QUEUE_PER_THREAD) {
+            log_line("Refusing computer game for " + c->name);
+            std::string reason = ai.pool ? "Computer opponents are busy" : "No computer opponents on this server";
+            send_either(c, "INVALID:" + reason, Protocol::S_INVALID, reason);
+            c->close_after_flush = true;
+            flush(c);
+            return;
+        }
+        log_line("Player connected: " + c->name + " (vs computer)");
+
+        Connection* bot = new Connection(next_id.fetch_add(1), -1);
+        bot->bot = true;
+        bot->binary = true;
+        bot->name = "Computer";
+        start_room(c, bot);
+    }
+
+    // 輪到電腦：在 worker 上想，結果經 eventfd 送回這個 reactor
+    void think(Room* room) {
+        int budget = ai.move_ms;
+        if (time_control.timed()) {
+            long long share = room->remaining_ms[room->turn] / AI_TIME_SHARE;
+            if (share < budget) budget = (int)(share > 10 ? share : 10);
+        }
+        Reactor* self = this;
+        uint64_t room_id = room->id;
+        int ply = room->plies;
+        // 送回上一步（與 ponder）用的 worker，才用得到它置換表裡的節點
+        ai.pool->submit(room->game, room->pieces[room->turn], budget, 60,
+                        [self, room_id, ply](const SearchResult& r, int worker) {
+                            AiMove m = {room_id, ply, r.is_pass() ? -1 : r.row * 8 + r.col, worker};
+                            self->post(m);
+                        }, room->ai_worker);
+    }
+
+    // 輪到玩家：電腦在同一個 worker 上先替玩家想
+    void ponder(Room* room) {
+        if (!ai.ponder) return;
+        room->ai_worker = ai.pool->ponder(room->ai_worker, room->game, room->pieces[room->turn], room->id);
+    }
+
+    // 房間已經結束，或這段時間內盤面變了（例如超時判負），結果就丟掉
+    void play_ai_move(const AiMove& m) {
+        std::unordered_map<uint64_t, Room*>::iterator it = rooms.find(m.room_id);
+        if (it == rooms.end() || m.square < 0) return;
+        Room* room = it->second;
+        Connection* bot = room->players[room->turn];
+        if (room->plies != m.ply || !bot || !bot->bot) return;
+        room->ai_worker = m.worker;
+        play_move(bot, m.square / 8, m.square % 8);
+    }
+
+    // 配好的對手已經離開：接續的對局放回去，否則重新進大廳
+    void requeue(Connection* c, const ArchivedGame* saved) {
+        if (saved) {
+            resumes.add(*saved);
+            if (resume(c)) return;
+        }
+        join_lobby(c);
+    }
+
+    void join_lobby(Connection* c) {
+        c->state = Connection::LOBBY;
+        Lobby::Ticket me = {this, c->fd, c->id, c->rating, Lobby::Clock::time_point()};
+        Lobby::Ticket partner;
+        if (!lobby.join(me, partner)) {
+            send_either(c, "WAIT:Waiting for another player...",
+                        Protocol::S_WAIT, "Waiting for another player...");
+            return;
+        }
+        pair_with(c, partner);
+    }
+
+    // 大廳替 c 找到了對手；saved 不為 NULL 時是接續記錄裡的對局
+    void pair_with(Connection* c, const Lobby::Ticket& partner, const ArchivedGame* saved = NULL) {
+        if (partner.reactor == this) {
+            std::unordered_map<int, Connection*>::iterator it = connections.find(partner.fd);
+            if (it != connections.end() && it->second->id == partner.id && !it->second->closing) {
+                start_room(it->second, c, saved);
+            } else {
+                requeue(c, saved);
+            }
+            return;
+        }
+
+        // 對手在別的 reactor：把自己交過去，讓同一局由同一條執行緒處理
+        detach(c);
+        Handoff h = {c, partner.fd, partner.id, 0, saved ? new ArchivedGame(*saved) : NULL};
+        pending_handoff.push_back(std::make_pair(partner.reactor, h));
+    }
+
+    // 等待中的玩家隨時間放寬積分範圍；大廳替這個 reactor 的等待者配到的對手
+    void sweep_lobby() {
+        std::vector<std::pair<Lobby::Ticket, Lobby::Ticket> > matched;
+        lobby.sweep(this, matched);
+        for (size_t i = 0; i < matched.size(); i++) {
+            // 關閉中的連線在 process_closes() 就已離開大廳，所以這裡一定找得到
+            std::unordered_map<int, Connection*>::iterator it = connections.find(matched[i].first.fd);
+            if (it == connections.end() || it->second->id != matched[i].first.id) continue;
+            pair_with(it->second, matched[i].second);
+        }
+        process_resumes();
+        process_closes();
+        process_handoffs();
+    }
+
+    // saved 不為 NULL 時以記錄裡的編號開房，重播棋步後由輪到的一方接著下
+    void start_room(Connection* a, Connection* b, const ArchivedGame* saved = NULL) {
+        Room* room = new Room();
+        room->id = saved ? saved->id : next_id.fetch_add(1);
+        room->players[0] = a;
+        room->players[1] = b;
+        room->names[0] = a->name;
+        room->names[1] = b->name;
+        room->vs_ai = a->bot || b->bot;
+        room->ai_worker = -1;
+        rooms[room->id] = room;
+        directory.add(room->id, this);
+        metrics.rooms_started.add();
+        room->remaining_ms[0] = room->remaining_ms[1] = time_control.base_ms;
+        room->clock.owner = room;
+        room->clock.kind = TIMER_CLOCK;
+
+        char to_move = 'X';
+        if (saved) {
+            // 依名字坐回原本的顏色；雙方同名時 a 是先回來的，坐 X
+            int x = (a->name == saved->names[0]) ? 0 : 1;
+            room->pieces[x] = 'X';
+            room->pieces[1 - x] = 'O';
+            if (!saved->replay(room->game, to_move)) {
+                log_line(room_prefix(room) + "archived moves do not replay, starting over");
+                if (archive) archive->end(room->id, "Corrupt record");
+                room->game = Game();
+                to_move = 'X';
+                directory.remove(room->id);
+                rooms.erase(room->id);
+                room->id = next_id.fetch_add(1);
+                rooms[room->id] = room;
+                directory.add(room->id, this);
+                saved = NULL;
+            }
+            room->turn = (to_move == room->pieces[1]) ? 1 : 0;
+        } else {
+            room->turn = rng() % 2;
+            room->pieces[room->turn] = 'X';
+            room->pieces[1 - room->turn] = 'O';
+        }
+        if (!saved && archive && !room->vs_ai) archive->start(room->id, room->names[room->turn], room->names[1 - room->turn]);
+
+        for (int i = 0; i < 2; i++) {
+            room->players[i]->state = Connection::PLAYING;
+            room->players[i]->room = room;
+            room->players[i]->seat = i;
+        }
+
+        for (int i = 0; i < 2; i++) {
+            Connection* me = room->players[i];
+            Connection* other = room->players[1 - i];
+            std::string piece(1, room->pieces[i]);
+            send_either(me, "START:" + other->name + ":" + piece, Protocol::S_START, piece + other->name);
+            // 文字客戶端由接下來的 YOUR_TURN / OPPONENT_TURN 拿到盤面，二進位客戶端要另外送
+            if (saved && me->binary) {
+                send_frame(me, Protocol::S_SNAPSHOT,
+                           Protocol::snapshot_payload(room->game.get_pieces('X'), room->game.get_pieces('O'), to_move));
+            }
+        }
+
+        if (saved) {
+            log_line(room_prefix(room) + a->name + " vs " + b->name + " resumed after " +
+                     std::to_string(saved->moves.size()) + " moves");
+        } else {
+            log_line(room_prefix(room) + a->name + " (" + std::to_string(a->rating) + ") vs " +
+                     b->name + " (" + std::to_string(b->rating) + "), " +
+                     room->players[room->turn]->name + " (X) goes first!");
+        }
+        advance(room);
+    }
+
+    // 通知輪到誰；沒有合法步就 pass，雙方都不能下就結束
+    void advance(Room* room) {
+        while (true) {
+            int current = room->turn;
+            int opponent = 1 - current;
+            Connection* cur = room->players[current];
+            Connection* opp = room->players[opponent];
+
+            if (!room->game.has_valid_moves(room->pieces[current])) {
+                if (!room->game.has_valid_moves(room->pieces[opponent])) {
+                    int diff = room->game.get_black_count() - room->game.get_white_count();
+                    if (room->pieces[0] == 'O') diff = -diff;
+                    end_game(room, room->game.get_result(), diff > 0 ? 1.0 : (diff < 0 ? 0.0 : 0.5));
+                    return;
+                }
+                if (verbose) log_line(room_prefix(room) + cur->name + " has no valid moves, skipping...");
+                std::string passed(1, room->pieces[current]);
+                send_either(cur, "SKIP:" + room->game.get_board_state(), Protocol::S_PASS, passed);
+                send_either(opp, "OPPONENT_SKIP:" + room->game.get_board_state(), Protocol::S_PASS, passed);
+                broadcast(room, "SKIP:" + passed, Protocol::S_PASS, passed);
+                room->turn = opponent;
+                continue;
+            }
+
+            // 二進位客戶端自己從 MOVE / PASS 推算輪到誰，不必每步送盤面
+            if (!cur->binary) send_message(cur, "YOUR_TURN:" + room->game.get_board_state());
+            if (!opp->binary) send_message(opp, "OPPONENT_TURN:" + room->game.get_board_state());
+            start_clock(room);
+            if (cur->bot) {
+                think(room);
+            } else if (opp->bot) {
+                ponder(room);
+            }
+            return;
+        }
+    }
+
+    // score 為座位 0 的得分（1 勝、0.5 和、0 負）
+    void end_game(Room* room, const std::string& result, double score) {
+        std::string end_msg = "END:" + result + ":" + room->game.get_board_state();
+        for (int i = 0; i < 2; i++) {
+            if (room->players[i]) send_either(room->players[i], end_msg, Protocol::S_END, result);
+        }
+        broadcast(room, end_msg, Protocol::S_END, result);
+        log_line(room_prefix(room) + "Game over: " + result);
+        if (!room->vs_ai) {
+            if (archive) archive->end(room->id, result);
+            lobby.record_result(room->names[0], room->names[1], score);
+        }
+        finish_room(room);
+    }
+
+    // 輪到 room->turn 的一方開始計時；計時對局時把雙方剩餘時間送給所有人
+    void start_clock(Room* room) {
+        uint64_t now = now_ms();
+        room->turn_started_ms = now;
+        if (!time_control.timed()) {
+            if (time_control.abandon_ms > 0) wheel.schedule(&room->clock, now + time_control.abandon_ms);
+            return;
+        }
+        long long left = room->remaining_ms[room->turn];
+        wheel.schedule(&room->clock, now + (left > 0 ? left : 0));
+
+        int x = (room->pieces[0] == 'X') ? 0 : 1;
+        uint32_t x_ms = (uint32_t)room->remaining_ms[x];
+        uint32_t o_ms = (uint32_t)room->remaining_ms[1 - x];
+        std::string text = "CLOCK:" + std::to_string(x_ms) + ":" + std::to_string(o_ms);
+        std::string payload;
+        for (int i = 0; i < 4; i++) payload += (char)((x_ms >> (8 * i)) & 0xFF);
+        for (int i = 0; i < 4; i++) payload += (char)((o_ms >> (8 * i)) & 0xFF);
+        for (int i = 0; i < 2; i++) send_either(room->players[i], text, Protocol::S_CLOCK, payload);
+        broadcast(room, text, Protocol::S_CLOCK, payload);
+    }
+
+    // 扣掉這一步用的時間並加回增量；已經超時就回傳 false
+    bool charge_clock(Room* room, int seat) {
+        if (!time_control.timed()) return true;
+        long long used = (long long)(now_ms() - room->turn_started_ms);
+        room->remaining_ms[seat] -= used;
+        if (room->remaining_ms[seat] < 0) return false;
+        room->remaining_ms[seat] += time_control.increment_ms;
+        return true;
+    }
+
+    // 輪到的一方沒在時間內下：計時對局判超時負，不計時的對局視為棄局
+    void time_out(Room* room) {
+        int seat = room->turn;
+        std::string result = room->names[seat] +
+                             (time_control.timed() ? " lost on time" : " abandoned the game");
+        end_game(room, result, seat == 0 ? 0.0 : 1.0);
+    }
+
+    void on_timer(TimingWheel::Timer* t) {
+        switch (t->kind) {
+        case TIMER_LOGIN: {
+            Connection* c = static_cast<Connection*>(t->owner);
+            log_line("Login timeout, closing connection");
+            schedule_close(c);
+            break;
+        }
+        case TIMER_SLOW:
+            drop_slow_consumer(static_cast<Connection*>(t->owner));
+            break;
+        case TIMER_CLOCK:
+            time_out(static_cast<Room*>(t->owner));
+            break;
+        }
+    }
+
+    // 上次回報之後記了幾步、同步了幾次：每次同步平均帶幾步就是 group commit 的效果
+    void report_archive() {
+        uint64_t moves, syncs, bytes;
+        archive->stats(moves, syncs, bytes);
+        if (syncs == reported_syncs) return;
+        std::ostringstream ss;
+        ss.setf(std::ios::fixed);
+        ss.precision(1);
+        ss << "Archive: " << moves - reported_moves << " moves in " << syncs - reported_syncs << " syncs ("
+           << (double)(moves - reported_moves) / (syncs - reported_syncs) << " per sync), "
+           << bytes / 1024 << " KB total";
+        log_line(ss.str());
+        reported_moves = moves;
+        reported_syncs = syncs;
+    }
+
+    void process_timers() {
+        wheel.advance(now_ms());
+        while (TimingWheel::Timer* t = wheel.pop_ready()) {
+            on_timer(t);
+        }
+    }
+
+    void handle_move(Connection* c, const Slice& move) {
+        Room* room = c->room;
+        if (!room) return;
+
+        uint64_t start = now_ns();
+        int row, col;
+        if (!room->game.parse_move(move.data, move.size, row, col)) {
+            metrics.invalid_moves.add();
+            send_message(c, "INVALID:Invalid position format");
+            return;
+        }
+        metrics.parse.observe(now_ns() - start);
+        play_move(c, row, col);
+    }
+
+    // 各階段的耗時記在 metrics：檢查 → 套用 → 通知雙方與觀戰者
+    void play_move(Connection* c, int row, int col) {
+        Room* room = c->room;
+        if (!room) return;
+        uint64_t start = now_ns();
+        if (room->turn != c->seat) {
+            metrics.invalid_moves.add();
+            send_either(c, "INVALID:Not your turn", Protocol::S_INVALID, "Not your turn");
+            return;
+        }
+
+        char piece = room->pieces[c->seat];
+        if (!room->game.is_valid_move(row, col, piece)) {
+            metrics.invalid_moves.add();
+            send_either(c, "INVALID:Invalid move", Protocol::S_INVALID, "Invalid move");
+            return;
+        }
+        uint64_t validated = now_ns();
+        metrics.validate.observe(validated - start);
+
+        if (!charge_clock(room, c->seat)) {
+            time_out(room);
+            return;
+        }
+
+        if (room->vs_ai && !c->bot) ai.pool->stop_ponder(room->ai_worker, room->id);
+        room->game.make_move(row, col, piece);
+        room->plies++;
+        if (archive && !room->vs_ai) archive->move(room->id, row * 8 + col);
+        uint64_t applied = now_ns();
+        metrics.apply.observe(applied - validated);
+        metrics.moves.add();
+        std::string move;
+        move += (char)('a' + col);
+        move += (char)('8' - row);
+        if (verbose) log_line(room_prefix(room) + c->name + " (" + piece + ") played " + move);
+
+        // 文字協定只回覆下棋的人；二進位協定雙方都收到這一步
+        char other = room->pieces[1 - c->seat];
+        char next = room->game.has_valid_moves(other) ? other
+                  : (room->game.has_valid_moves(piece) ? piece : '*');
+        std::string delta;
+        delta += (char)(row * 8 + col);
+        delta += piece;
+        delta += next;
+        for (int i = 0; i < 2; i++) {
+            Connection* p = room->players[i];
+            if (p->binary) {
+                send_frame(p, Protocol::S_MOVE, delta);
+            } else if (p == c) {
+                send_message(p, "MOVE_OK:" + move);
+            }
+        }
+        if (!room->spectators.empty()) {
+            broadcast(room, "MOVE:" + std::string(1, piece) + ":" + move + ":" + next + ":" +
+                            room->game.get_board_state(), Protocol::S_MOVE, delta);
+        }
+        metrics.broadcast.observe(now_ns() - applied);
+
+        room->turn = 1 - c->seat;
+        advance(room);
+    }
+
+public:
+    Reactor(int i, Lobby& l, RoomDirectory& d, ResumeTable& r, GameArchive* a, const AiSettings& s,
+            std::atomic<uint64_t>& ids, const TimeControl& tc, MetricsShard& m, bool log_moves)
+        : lobby(l), directory(d), resumes(r), archive(a), ai(s), next_id(ids), index(i), verbose(log_moves),
+          server_fd(-1), epoll_fd(-1), wakeup_fd(-1), reported_moves(0), reported_syncs(0),
+          rng((unsigned)time(NULL) * 31 + i), time_control(tc), wheel(now_ms()), metrics(m) {}
+
+    ~Reactor() {
+        for (size_t i = 0; i < inbox.size(); i++) {
+            close(inbox[i].conn->fd);
+            delete inbox[i].conn;
+            delete inbox[i].resume;
+        }
+        for (std::unordered_map<uint64_t, Room*>::iterator it = rooms.begin(); it != rooms.end(); ++it) {
+            for (int i = 0; i < 2; i++) {
+                if (it->second->players[i] && it->second->players[i]->bot) delete it->second->players[i];
+            }
+            delete it->second;
+        }
+        for (std::unordered_map<int, Connection*>::iterator it = connections.begin(); it != connections.end(); ++it) {
+            close(it->first);
+            delete it->second;
+        }
+        if (wakeup_fd != -1) close(wakeup_fd);
+        if (epoll_fd != -1) close(epoll_fd);
         if (server_fd != -1) close(server_fd);
     }
-    
+
+    // 由其他 reactor 呼叫
+    void post(const Handoff& h) {
+        {
+            std::lock_guard<std::mutex> lock(inbox_mutex);
+            inbox.push_back(h);
+        }
+        uint64_t one = 1;
+        ssize_t n = write(wakeup_fd, &one, sizeof(one));
+        (void)n;
+    }
+
+    // 由 AiPool 的 worker 呼叫
+    void post(const AiMove& m) {
+        {
+            std::lock_guard<std::mutex> lock(inbox_mutex);
+            ai_moves.push_back(m);
+        }
+        uint64_t one = 1;
+        ssize_t n = write(wakeup_fd, &one, sizeof(one));
+        (void)n;
+    }
+
     bool start(const std::string& ip, int port) {
-        server_fd = socket(AF_INET, SOCK_STREAM, 0);
-        if (server_fd == 0) {
+        server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (server_fd < 0) {
             std::cerr << "Socket creation failed\n";
             return false;
         }
-        
+
         int opt = 1;
         if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
             std::cerr << "Setsockopt failed\n";
             return false;
         }
-        
+
         struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
         address.sin_family = AF_INET;
         address.sin_addr.s_addr = inet_addr(ip.c_str());
         address.sin_port = htons(port);
-        
+
         if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
             std::cerr << "Bind failed\n";
             return false;
         }
-        
-        if (listen(server_fd, 2) < 0) {
+
+        if (listen(server_fd, SOMAXCONN) < 0) {
             std::cerr << "Listen failed\n";
             return false;
         }
-        
-        std::cout << "Server started on " << ip << ":" << port << "\n";
-        std::cout << "Waiting for players...\n";
-        
+
+        epoll_fd = epoll_create1(0);
+        if (epoll_fd < 0) {
+            std::cerr << "epoll_create1 failed\n";
+            return false;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.ptr = NULL;          // NULL 代表監聽 socket
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &ev) < 0) {
+            std::cerr << "epoll_ctl failed\n";
+            return false;
+        }
+
+        wakeup_fd = eventfd(0, EFD_NONBLOCK);
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.ptr = &inbox;        // inbox 的位址代表 eventfd
+        if (wakeup_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &ev) < 0) {
+            std::cerr << "eventfd failed\n";
+            return false;
+        }
+
         return true;
     }
-    
-    void wait_for_players() {
-        struct sockaddr_in address;
-        int addrlen = sizeof(address);
-        
-        client_sockets[0] = accept(server_fd, (struct sockaddr*)&address, (socklen_t*)&addrlen);
-        if (client_sockets[0] < 0) {
-            std::cerr << "Accept failed for player 1\n";
-            return;
-        }
-        
-        player_names[0] = receive_message(0);
-        std::cout << "Player 1 connected: " << player_names[0] << "\n";
-        send_message(0, "WAIT:Waiting for another player...");
-        
-        client_sockets[1] = accept(server_fd, (struct sockaddr*)&address, (socklen_t*)&addrlen);
-        if (client_sockets[1] < 0) {
-            std::cerr << "Accept failed for player 2\n";
-            return;
-        }
-        
-        player_names[1] = receive_message(1);
-        std::cout << "Player 2 connected: " << player_names[1] << "\n";
-        
-        srand(time(NULL));
-        current_turn = rand() % 2;
-        player_pieces[current_turn] = 'X';
-        player_pieces[1 - current_turn] = 'O';
-        
-        std::string start_msg_0 = "START:" + player_names[1] + ":" + std::string(1, player_pieces[0]);
-        std::string start_msg_1 = "START:" + player_names[0] + ":" + std::string(1, player_pieces[1]);
-        
-        send_message(0, start_msg_0);
-        send_message(1, start_msg_1);
-        
-        std::cout << player_names[current_turn] << " (" << player_pieces[current_turn] << ") goes first!\n";
-    }
-    
-    void run_game() {
+
+    void run() {
+        struct epoll_event events[MAX_EVENTS];
+        Lobby::Clock::time_point next_sweep = Lobby::Clock::now();
+        Lobby::Clock::time_point next_report = next_sweep + std::chrono::seconds(LOBBY_REPORT_SECONDS);
         while (true) {
-            int opponent = 1 - current_turn;
-            
-            if (!check_client_connected(current_turn)) {
-                std::cout << player_names[current_turn] << " disconnected\n";
-                send_message(opponent, "OPPONENT_DISCONNECT:");
-                break;
+            int timeout = LOBBY_SWEEP_MS;
+            uint64_t deadline = wheel.next_deadline();
+            if (deadline != UINT64_MAX) {
+                uint64_t now = now_ms();
+                if (deadline <= now) {
+                    timeout = 0;
+                } else if (deadline - now < (uint64_t)timeout) {
+                    timeout = (int)(deadline - now);
+                }
             }
-            if (!check_client_connected(opponent)) {
-                std::cout << player_names[opponent] << " disconnected\n";
-                send_message(current_turn, "OPPONENT_DISCONNECT:");
-                break;
+            int n = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "epoll_wait failed: " << strerror(errno) << "\n";
+                return;
             }
-            
-            if (!game->has_valid_moves(player_pieces[current_turn])) {
-                if (!game->has_valid_moves(player_pieces[opponent])) {
-                    std::string result = game->get_result();
-                    std::string end_msg = "END:" + result + ":" + game->get_board_state();
-                    send_message(0, end_msg);
-                    send_message(1, end_msg);
-                    std::cout << "Game over: " << result << "\n";
-                    break;
+
+            for (int i = 0; i < n; i++) {
+                void* ptr = events[i].data.ptr;
+                if (!ptr) {
+                    accept_clients();
+                } else if (ptr == &inbox) {
+                    drain_inbox();
                 } else {
-                    std::cout << player_names[current_turn] << " has no valid moves, skipping...\n";
-                    std::string skip_msg = "SKIP:" + game->get_board_state();
-                    send_message(current_turn, skip_msg);
-                    send_message(opponent, "OPPONENT_SKIP:" + game->get_board_state());
-                    current_turn = opponent;
-                    continue;
+                    Connection* c = static_cast<Connection*>(ptr);
+                    if (c->closing || c->state == Connection::HANDOFF) continue;
+
+                    uint32_t e = events[i].events;
+                    if (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                        handle_read(c);
+                        // 慢速連線沒有去讀，斷線要在這裡發現
+                        if (c->slow && (e & (EPOLLHUP | EPOLLERR))) schedule_close(c);
+                    }
+                    if ((e & EPOLLOUT) && !c->closing && c->state != Connection::HANDOFF) {
+                        flush(c);
+                    }
                 }
+                process_resumes();
+                process_closes();
+                process_handoffs();
             }
-            
-            std::string state_current = "YOUR_TURN:" + game->get_board_state();
-            std::string state_opponent = "OPPONENT_TURN:" + game->get_board_state();
-            
-            send_message(current_turn, state_current);
-            send_message(opponent, state_opponent);
-            
-            bool valid_move = false;
-            while (!valid_move) {
-                if (!check_client_connected(current_turn)) {
-                    std::cout << player_names[current_turn] << " disconnected\n";
-                    send_message(opponent, "OPPONENT_DISCONNECT:");
-                    return;
-                }
-                if (!check_client_connected(opponent)) {
-                    std::cout << player_names[opponent] << " disconnected\n";
-                    send_message(current_turn, "OPPONENT_DISCONNECT:");
-                    return;
-                }
-                
-                std::string move = receive_message(current_turn);
-                if (move.empty()) {
-                    std::cout << player_names[current_turn] << " disconnected\n";
-                    send_message(opponent, "OPPONENT_DISCONNECT:");
-                    return;
-                }
-                
-                int row, col;
-                if (!game->parse_move(move, row, col)) {
-                    send_message(current_turn, "INVALID:Invalid position format");
-                    continue;
-                }
-                
-                if (!game->is_valid_move(row, col, player_pieces[current_turn])) {
-                    send_message(current_turn, "INVALID:Invalid move");
-                    continue;
-                }
-                
-                game->make_move(row, col, player_pieces[current_turn]);
-                std::cout << player_names[current_turn] << " (" << player_pieces[current_turn] 
-                         << ") played " << move << "\n";
-                
-                send_message(current_turn, "MOVE_OK:" + move);
-                
-                valid_move = true;
+
+            process_timers();
+            process_resumes();
+            process_closes();
+            process_handoffs();
+
+            Lobby::Clock::time_point now = Lobby::Clock::now();
+            if (now >= next_sweep) {
+                sweep_lobby();
+                next_sweep = now + std::chrono::milliseconds(LOBBY_SWEEP_MS);
+            }
+            // 統計只由第一個 reactor 印出
+            if (index == 0 && now >= next_report) {
+                std::string line = lobby.report();
+                if (!line.empty()) log_line(line);
+                if (archive) report_archive();
+                next_report = now + std::chrono::seconds(LOBBY_REPORT_SECONDS);
+            }
+
+            for (size_t i = 0; i < dead.size(); i++) {
+                delete dead[i];
             }
-            
-            current_turn = opponent;
+            dead.clear();
         }
     }
 };
 
+// 命令列參數
+struct ServerOptions {
+    std::string ip;
+    int port;
+    int reactors;
+    TimeControl time_control;
+    std::string archive_path;       // 空字串代表不寫對局記錄
+    std::string metrics_at;         // 空字串代表不開統計端點
+    int ai_threads;                 // 0 代表不提供電腦對手
+    int ai_move_ms;
+    bool ai_ponder;
+    const OpeningBook* book;        // 電腦對手用，可為 NULL
+    bool verbose;
+};
+
+// 啟動 N 個 reactor，各自監聽同一個 port，由核心分配新連線
+class Server {
+private:
+    Lobby lobby;
+    RoomDirectory directory;
+    ResumeTable resumes;
+    GameArchive* archive;
+    AiSettings ai;
+    TimeControl time_control;
+    std::atomic<uint64_t> next_id;
+    std::vector<Reactor*> reactors;
+    Metrics* metrics;                   // 每個 reactor 一個分片
+    MetricsEndpoint* endpoint;
+
+    Server(const Server&);
+    Server& operator=(const Server&);
+
+    void add_ai_probes() {
+        AiPool* pool = ai.pool;
+        metrics->add_probe("reversi_ai_queue_depth", "gauge", "Computer moves waiting for a worker",
+                           [pool]() { return pool->queue_depth(); });
+        metrics->add_probe("reversi_ai_busy_workers", "gauge", "Workers currently searching",
+                           [pool]() { return pool->busy(); });
+        metrics->add_probe("reversi_ai_jobs_total", "counter", "Computer moves searched",
+                           [pool]() { return pool->jobs_completed(); });
+        metrics->add_probe("reversi_ai_jobs_stolen_total", "counter", "Jobs taken from another worker's queue",
+                           [pool]() { return pool->jobs_stolen(); });
+        metrics->add_probe("reversi_ai_cpu_microseconds_total", "counter", "CPU time spent searching",
+                           [pool]() { return pool->cpu_microseconds(); });
+        metrics->add_probe("reversi_ai_queue_wait_microseconds_total", "counter", "Time jobs spent queued",
+                           [pool]() { return pool->wait_microseconds(); });
+        metrics->add_probe("reversi_ai_ponders_total", "counter", "Times a worker searched while the player was thinking",
+                           [pool]() { return pool->ponders_started(); });
+        metrics->add_probe("reversi_ai_ponder_cpu_microseconds_total", "counter", "CPU time spent pondering",
+                           [pool]() { return pool->ponder_microseconds(); });
+    }
+
+public:
+    Server() : archive(NULL), next_id(1), metrics(NULL), endpoint(NULL) {
+        ai.pool = NULL;
+        ai.move_ms = 0;
+        ai.ponder = false;
+    }
+
+    ~Server() {
+        delete endpoint;
+        delete ai.pool;             // worker 會把結果送回 reactor，要先停
+        for (size_t i = 0; i < reactors.size(); i++) {
+            delete reactors[i];
+        }
+        delete archive;             // 寫完剩下的記錄才返回
+        delete metrics;
+    }
+
+    bool start(const ServerOptions& options) {
+        time_control = options.time_control;
+        size_t unfinished_count = 0;
+        if (!options.archive_path.empty()) {
+            archive = new GameArchive();
+            std::vector<ArchivedGame> unfinished;
+            uint64_t max_id = 0;
+            if (!archive->open(options.archive_path, unfinished, max_id)) {
+                std::cerr << "Cannot open game archive " << options.archive_path << "\n";
+                return false;
+            }
+            next_id = max_id + 1;
+            for (size_t i = 0; i < unfinished.size(); i++) resumes.add(unfinished[i]);
+            unfinished_count = unfinished.size();
+        }
+
+        metrics = new Metrics(options.reactors);
+        if (options.ai_threads > 0) {
+            ai.pool = new AiPool(options.ai_threads, options.book);
+            ai.move_ms = options.ai_move_ms;
+            ai.ponder = options.ai_ponder;
+            add_ai_probes();
+        }
+        for (int i = 0; i < options.reactors; i++) {
+            Reactor* r = new Reactor(i, lobby, directory, resumes, archive, ai, next_id, time_control,
+                                     metrics->shard(i), options.verbose);
+            reactors.push_back(r);
+            if (!r->start(options.ip, options.port)) return false;
+        }
+        if (!options.metrics_at.empty()) {
+            endpoint = new MetricsEndpoint(*metrics);
+            if (!endpoint->start(options.metrics_at)) {
+                std::cerr << "Cannot open metrics endpoint " << options.metrics_at << "\n";
+                return false;
+            }
+        }
+
+        std::cout << "Server started on " << options.ip << ":" << options.port
+                  << " (" << options.reactors << " reactor" << (options.reactors > 1 ? "s" : "") << ")\n";
+        if (time_control.timed()) {
+            std::cout << "Time control: " << time_control.base_ms / 1000.0 << "s + "
+                      << time_control.increment_ms / 1000.0 << "s per move\n";
+        }
+        if (archive) {
+            std::cout << "Archiving games to " << options.archive_path << " (" << unfinished_count
+                      << " unfinished game" << (unfinished_count == 1 ? "" : "s") << " can be resumed)\n";
+        }
+        if (ai.pool) {
+            std::cout << "Computer opponents: " << ai.pool->threads() << " worker"
+                      << (ai.pool->threads() > 1 ? "s" : "") << ", " << ai.move_ms << " ms per move"
+                      << (ai.ponder ? ", pondering" : "") << " (log in as <name>" << AI_SUFFIX << ")\n";
+        }
+        if (!options.metrics_at.empty()) {
+            const std::string& at = options.metrics_at;
+            std::cout << "Metrics on " << (at[0] == '/' ? at : "127.0.0.1:" + at) << "\n";
+        }
+        std::cout << "Waiting for players...\n";
+        return true;
+    }
+
+    void run() {
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < reactors.size(); i++) {
+            threads.push_back(std::thread(&Reactor::run, reactors[i]));
+        }
+        reactors[0]->run();
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+};
+
+static void usage(const char* prog) {
+    std::cout << "Usage: " << prog << " <ip> <port> [--book <book.bin>] [--reactors <n>]\n"
+              << "              [--clock <seconds>[+<increment>]] [--abandon <seconds>]\n"
+              << "              [--archive <file>] [--metrics <port>|<socket path>]\n"
+              << "              [--ai-threads <n>] [--ai-ms <ms>] [--no-ponder] [--weights <file>] [--quiet]\n"
+              << "  --reactors 0 starts one reactor per CPU core (default 1)\n"
+              << "  --clock     per-player time control, e.g. 300+5 (Fischer) or 60 (sudden death)\n"
+              << "  --abandon   untimed games: forfeit after this long without a move (default 300, 0 = never)\n"
+              << "  --archive   append every game to this log; unfinished games resume when both players log in again\n"
+              << "  --metrics   serve Prometheus-style counters on 127.0.0.1:<port> or a Unix socket\n"
+              << "  --ai-threads  workers thinking for computer opponents (default 1, 0 = none)\n"
+              << "  --ai-ms     computer thinking time per move (default 1000)\n"
+              << "  --no-ponder computer does not think on the player's time\n"
+              << "  --weights   evaluation weights written by trainer (default: built-in)\n"
+              << "  --quiet     do not log every move\n";
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cout << "Usage: " << argv[0] << " <ip> <port>\n";
+    if (argc < 3) {
+        usage(argv[0]);
         return 1;
     }
-    
-    std::string ip = argv[1];
-    int port = atoi(argv[2]);
-    
+
+    ServerOptions options;
+    options.ip = argv[1];
+    options.port = atoi(argv[2]);
+    options.reactors = 1;
+    TimeControl default_control = {0, 0, 300 * 1000LL};
+    options.time_control = default_control;
+    options.ai_threads = 1;
+    options.ai_move_ms = 1000;
+    options.ai_ponder = true;
+    options.book = NULL;
+    options.verbose = true;
+    std::string book_path, weights_path;
+    TimeControl& time_control = options.time_control;
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--book" && i + 1 < argc) {
+            book_path = argv[++i];
+        } else if (arg == "--reactors" && i + 1 < argc) {
+            options.reactors = atoi(argv[++i]);
+        } else if (arg == "--clock" && i + 1 < argc) {
+            char* end = NULL;
+            time_control.base_ms = (long long)(strtod(argv[++i], &end) * 1000);
+            if (*end == '+') time_control.increment_ms = (long long)(strtod(end + 1, &end) * 1000);
+            if (*end != '\0' || time_control.base_ms <= 0 || time_control.increment_ms < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--abandon" && i + 1 < argc) {
+            time_control.abandon_ms = (long long)(atof(argv[++i]) * 1000);
+        } else if (arg == "--archive" && i + 1 < argc) {
+            options.archive_path = argv[++i];
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            options.metrics_at = argv[++i];
+        } else if (arg == "--ai-threads" && i + 1 < argc) {
+            options.ai_threads = atoi(argv[++i]);
+        } else if (arg == "--ai-ms" && i + 1 < argc) {
+            options.ai_move_ms = atoi(argv[++i]);
+            if (options.ai_move_ms <= 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--no-ponder") {
+            options.ai_ponder = false;
+        } else if (arg == "--weights" && i + 1 < argc) {
+            weights_path = argv[++i];
+        } else if (arg == "--quiet") {
+            options.verbose = false;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.reactors <= 0) options.reactors = (int)std::thread::hardware_concurrency();
+    if (options.reactors <= 0) options.reactors = 1;
+
+    // 開局庫在啟動時 mmap 進來，電腦對手之後直接查表
+    OpeningBook book;
+    if (!book_path.empty()) {
+        if (!book.open(book_path)) {
+            std::cerr << "Cannot load opening book " << book_path << "\n";
+            return 1;
+        }
+        std::cout << "Opening book loaded: " << book.size() << " entries\n";
+        options.book = &book;
+    }
+
+    // 訓練出來的評估權重同樣 mmap 進來，所有 Engine 共用
+    WeightFile weights;
+    if (!weights_path.empty()) {
+        if (!weights.open(weights_path, Evaluator::instance())) {
+            std::cerr << "Cannot load weights " << weights_path << "\n";
+            return 1;
+        }
+        Evaluator::instance().set_weights(weights.weights());
+        std::cout << "Evaluation weights loaded from " << weights_path << "\n";
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
     Server server;
-    if (!server.start(ip, port)) {
+    if (!server.start(options)) {
         return 1;
     }
-    
-    server.wait_for_players();
-    server.run_game();
-    
+
+    server.run();
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,115 @@
+#ifndef SMP_HPP
+#define SMP_HPP
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "engine.hpp"
+#include "transposition.hpp"
+
+// Lazy SMP：N 個執行緒從同一個根節點各自做迭代加深，
+// 只透過共用的置換表交換資訊；主執行緒（id 0）的結果為最終答案。
+class ParallelSearch {
+private:
+    TranspositionTable table;
+    std::vector<Engine*> engines;
+    std::atomic<bool> stop;
+    const OpeningBook* book;
+    unsigned long long total_nodes;
+
+    ParallelSearch(const ParallelSearch&);
+    ParallelSearch& operator=(const ParallelSearch&);
+
+    void release() {
+        for (size_t i = 0; i < engines.size(); i++) {
+            delete engines[i];
+        }
+        engines.clear();
+    }
+
+public:
+    explicit ParallelSearch(int threads = 1, size_t tt_megabytes = 64)
+        : table(tt_megabytes), stop(false), book(NULL), total_nodes(0) {
+        set_threads(threads);
+    }
+
+    ~ParallelSearch() {
+        release();
+    }
+
+    // 伺服器可用這個上限控制 AI 對局能吃掉多少 CPU
+    void set_threads(int threads) {
+        if (threads < 1) threads = 1;
+        if (threads > TranspositionTable::MAX_SHARDS) threads = TranspositionTable::MAX_SHARDS;
+        release();
+        for (int i = 0; i < threads; i++) {
+            Engine* e = new Engine(&table);
+            e->set_thread_id(i);
+            e->set_stop_flag(&stop);
+            // 一半的輔助執行緒從深一層開始，讓大家不要同步搜同一棵樹
+            e->set_depth_offset(i % 2);
+            e->set_book(book);
+            engines.push_back(e);
+        }
+    }
+
+    int get_threads() const { return (int)engines.size(); }
+
+    void clear() {
+        table.clear();
+        for (size_t i = 0; i < engines.size(); i++) {
+            engines[i]->clear();
+        }
+    }
+
+    // 開局庫只由主執行緒查詢
+    void set_book(const OpeningBook* b) {
+        book = b;
+        for (size_t i = 0; i < engines.size(); i++) {
+            engines[i]->set_book(b);
+        }
+    }
+
+    SearchResult search(const Game& game, char player, Engine::Clock::time_point deadline, int max_depth = 60) {
+        stop.store(false);
+
+        // 開局庫命中時不必叫醒輔助執行緒
+        BookMove hit;
+        if (book && book->best_move(game, player, hit)) {
+            SearchResult result = engines[0]->search(game, player, deadline, max_depth);
+            total_nodes = result.nodes;
+            return result;
+        }
+
+        std::vector<std::thread> helpers;
+        for (size_t i = 1; i < engines.size(); i++) {
+            Engine* e = engines[i];
+            helpers.push_back(std::thread([e, &game, player, deadline, max_depth]() {
+                e->search(game, player, deadline, max_depth);
+            }));
+        }
+
+        SearchResult result = engines[0]->search(game, player, deadline, max_depth);
+
+        stop.store(true);
+        for (size_t i = 0; i < helpers.size(); i++) {
+            helpers[i].join();
+        }
+
+        total_nodes = 0;
+        for (size_t i = 0; i < engines.size(); i++) {
+            total_nodes += engines[i]->get_nodes();
+        }
+        result.nodes = total_nodes;
+        return result;
+    }
+
+    SearchResult search_for(const Game& game, char player, int millis, int max_depth = 60) {
+        return search(game, player, Engine::Clock::now() + std::chrono::milliseconds(millis), max_depth);
+    }
+
+    TranspositionTable& get_table() { return table; }
+    unsigned long long get_nodes() const { return total_nodes; }
+};
+
+#endif // SMP_HPP
@@ -0,0 +1,179 @@
+#ifndef TIMING_WHEEL_HPP
+#define TIMING_WHEEL_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+// 階層式計時輪
+//
+// 第 0 層 256 格、每格 1 tick；第 1～3 層各 64 格，每格是下一層一整圈。
+// tick 為 10 ms 時可排到約 7.7 天後，更遠的會被壓到最遠的一格。
+// 計時器是嵌在擁有者裡的雙向鏈結節點，排入與取消都是 O(1)；
+// 第 0 層轉完一圈時才把上一層的一格往下分散（cascade）。
+//
+// 到期的計時器先移到 ready 串列，由呼叫端用 pop_ready() 一個一個取出處理，
+// 處理中取消別的計時器（包括已經到期、還沒取出的）也是安全的。
+class TimingWheel {
+public:
+    struct Timer {
+        Timer* prev;
+        Timer* next;            // NULL 代表沒有排入
+        uint64_t expires;       // tick
+        bool due;               // 已到期，在 ready 串列上
+        void* owner;
+        int kind;
+
+        Timer() : prev(NULL), next(NULL), expires(0), due(false), owner(NULL), kind(0) {}
+        bool armed() const { return next != NULL; }
+    };
+
+private:
+    static const int ROOT_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int LEVELS = 4;
+    static const int ROOT_SIZE = 1 << ROOT_BITS;
+    static const int LEVEL_SIZE = 1 << LEVEL_BITS;
+    static const uint64_t MAX_DELTA = ((uint64_t)1 << (ROOT_BITS + LEVEL_BITS * (LEVELS - 1))) - 1;
+
+    uint64_t base_ms;
+    uint64_t tick_ms;
+    uint64_t current;           // 下一個要處理的 tick
+    size_t count;               // 排在輪上的計時器（不含 ready）
+    Timer root[ROOT_SIZE];
+    Timer levels[LEVELS - 1][LEVEL_SIZE];
+    Timer ready;
+
+    TimingWheel(const TimingWheel&);
+    TimingWheel& operator=(const TimingWheel&);
+
+    static void init_list(Timer* head) {
+        head->prev = head->next = head;
+    }
+
+    static bool list_empty(const Timer* head) {
+        return head->next == head;
+    }
+
+    static void link(Timer* head, Timer* t) {
+        t->prev = head->prev;
+        t->next = head;
+        head->prev->next = t;
+        head->prev = t;
+    }
+
+    static void unlink(Timer* t) {
+        t->prev->next = t->next;
+        t->next->prev = t->prev;
+        t->prev = t->next = NULL;
+    }
+
+    Timer* slot_for(uint64_t expires) {
+        if (expires < current) expires = current;
+        uint64_t delta = expires - current;
+        if (delta < (uint64_t)ROOT_SIZE) return &root[expires & (ROOT_SIZE - 1)];
+        for (int level = 0; level < LEVELS - 1; level++) {
+            int shift = ROOT_BITS + LEVEL_BITS * level;
+            if (delta < ((uint64_t)1 << (shift + LEVEL_BITS))) {
+                return &levels[level][(expires >> shift) & (LEVEL_SIZE - 1)];
+            }
+        }
+        return NULL;            // schedule() 已經把 delta 壓在 MAX_DELTA 以內
+    }
+
+    // 把上層的一格重新分配到下層；回傳該格的索引，為 0 代表這一層也轉完一圈
+    int cascade(int level) {
+        int shift = ROOT_BITS + LEVEL_BITS * level;
+        int index = (int)((current >> shift) & (LEVEL_SIZE - 1));
+        Timer* head = &levels[level][index];
+        while (!list_empty(head)) {
+            Timer* t = head->next;
+            unlink(t);
+            link(slot_for(t->expires), t);
+        }
+        return index;
+    }
+
+    void process_tick() {
+        int index = (int)(current & (ROOT_SIZE - 1));
+        if (index == 0) {
+            for (int level = 0; level < LEVELS - 1 && cascade(level) == 0; level++) {}
+        }
+        Timer* head = &root[index];
+        while (!list_empty(head)) {
+            Timer* t = head->next;
+            unlink(t);
+            link(&ready, t);
+            t->due = true;
+            count--;
+        }
+        current++;
+    }
+
+public:
+    TimingWheel(uint64_t now_ms, uint64_t tick = 10)
+        : base_ms(now_ms), tick_ms(tick), current(0), count(0) {
+        for (int i = 0; i < ROOT_SIZE; i++) init_list(&root[i]);
+        for (int l = 0; l < LEVELS - 1; l++) {
+            for (int i = 0; i < LEVEL_SIZE; i++) init_list(&levels[l][i]);
+        }
+        init_list(&ready);
+    }
+
+    size_t size() const { return count; }
+
+    // 在 deadline_ms（與建構時的 now_ms 同一個時鐘）之後觸發；已排入的會先取消
+    void schedule(Timer* t, uint64_t deadline_ms) {
+        cancel(t);
+        uint64_t tick = (deadline_ms > base_ms) ? (deadline_ms - base_ms + tick_ms - 1) / tick_ms : 0;
+        if (tick < current) tick = current;
+        if (tick - current > MAX_DELTA) tick = current + MAX_DELTA;
+        t->expires = tick;
+        link(slot_for(tick), t);
+        count++;
+    }
+
+    void cancel(Timer* t) {
+        if (!t->armed()) return;
+        unlink(t);
+        if (t->due) {
+            t->due = false;
+        } else {
+            count--;
+        }
+    }
+
+    // 把到 now_ms 為止到期的計時器移到 ready 串列
+    void advance(uint64_t now_ms) {
+        if (now_ms < base_ms) return;
+        uint64_t target = (now_ms - base_ms) / tick_ms;
+        if (count == 0) {
+            if (current <= target) current = target + 1;   // 輪上是空的，直接跳過
+            return;
+        }
+        while (current <= target) process_tick();
+    }
+
+    Timer* pop_ready() {
+        if (list_empty(&ready)) return NULL;
+        Timer* t = ready.next;
+        unlink(t);
+        t->due = false;
+        return t;
+    }
+
+    // 下一次需要呼叫 advance() 的時間（ms）；沒有計時器時回傳 UINT64_MAX
+    uint64_t next_deadline() const {
+        if (!list_empty(&ready)) return 0;
+        if (count == 0) return UINT64_MAX;
+        for (int i = 0; i < ROOT_SIZE; i++) {
+            uint64_t tick = current + i;
+            // 第 0 層轉完一圈時要從上層 cascade，也得醒來
+            if ((tick & (ROOT_SIZE - 1)) == 0 || !list_empty(&root[tick & (ROOT_SIZE - 1)])) {
+                return base_ms + tick * tick_ms;
+            }
+        }
+        return base_ms + (current + ROOT_SIZE) * tick_ms;
+    }
+};
+
+#endif // TIMING_WHEEL_HPP
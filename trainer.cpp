@@ -0,0 +1,328 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "bitboard.hpp"
+#include "eval.hpp"
+#include "training.hpp"
+
+// 評估權重訓練：以自我對局資料（selfplay 產生）做最小平方法
+//
+// 目標是讓 Evaluator 以 X 為視角的分數接近終局棋子差（× Engine 的 DISC = 100）。
+// 一個局面只會用到它所在階段的權重，各階段是互不相干的最小平方問題，
+// 所以每條執行緒一次負責一個階段，在那個階段的局面上做 minibatch 梯度下降，彼此不需要同步；
+// 局面的打亂與分批只看階段與 epoch，結果與執行緒數無關。
+// 每隔固定區塊取一塊當驗證資料，每個 epoch 印出訓練與驗證的誤差（以棋子為單位）。
+
+typedef std::chrono::steady_clock Clock;
+
+static const int DISC = 100;
+
+// 一個局面的特徵：各樣式的索引、階段、行動力差、潛在行動力差
+struct Sample {
+    uint16_t idx[Evaluator::INSTANCES];
+    uint8_t phase;
+    int8_t mobility;
+    int8_t potential;
+    float target;
+};
+
+struct TrainOptions {
+    int epochs;
+    int threads;
+    int batch;
+    double rate;
+    int holdout;                // 每 holdout 個區塊取一塊當驗證資料
+};
+
+class Trainer {
+private:
+    const Evaluator& evaluator;
+    const TrainOptions& options;
+    int phase_size;
+    int mobility_at;            // 各階段中行動力權重的位置
+    std::vector<int> offset_of; // 各樣式實例的權重起點
+    std::vector<Sample> samples;
+    std::vector<std::vector<uint32_t> > train_by_phase;
+    std::vector<uint32_t> validation;
+    std::vector<float> weights;
+
+    Trainer(const Trainer&);
+    Trainer& operator=(const Trainer&);
+
+    float predict(const Sample& s) const {
+        const float* w = &weights[(size_t)s.phase * phase_size];
+        float sum = 0;
+        for (int i = 0; i < Evaluator::INSTANCES; i++) sum += w[offset_of[i] + s.idx[i]];
+        sum += w[mobility_at + Evaluator::MOBILITY_WEIGHT] * s.mobility;
+        sum += w[mobility_at + Evaluator::POTENTIAL_WEIGHT] * s.potential;
+        return sum;
+    }
+
+    // 一個階段跑一個 epoch，回傳更新前的誤差平方和
+    double train_phase(int phase, int epoch, std::vector<float>& grad, std::vector<uint32_t>& hits,
+                       std::vector<int>& touched) {
+        std::vector<uint32_t>& order = train_by_phase[phase];
+        std::mt19937 rng(epoch * 131 + phase);
+        std::shuffle(order.begin(), order.end(), rng);
+
+        float* w = &weights[(size_t)phase * phase_size];
+        double squared = 0;
+        for (size_t begin = 0; begin < order.size(); begin += options.batch) {
+            size_t end = std::min(order.size(), begin + (size_t)options.batch);
+            double scalar_grad[2] = {0, 0}, scalar_norm[2] = {0, 0};
+            for (size_t k = begin; k < end; k++) {
+                const Sample& s = samples[order[k]];
+                float residual = s.target - predict(s);
+                squared += (double)residual * residual;
+                for (int i = 0; i < Evaluator::INSTANCES; i++) {
+                    int j = offset_of[i] + s.idx[i];
+                    if (hits[j] == 0) touched.push_back(j);
+                    grad[j] += residual;
+                    hits[j]++;
+                }
+                scalar_grad[0] += residual * s.mobility;
+                scalar_norm[0] += s.mobility * s.mobility;
+                scalar_grad[1] += residual * s.potential;
+                scalar_norm[1] += s.potential * s.potential;
+            }
+
+            // 每個權重依它在這批出現的次數取平均殘差；rate 約為同時出現的特徵數的倒數
+            for (size_t t = 0; t < touched.size(); t++) {
+                int j = touched[t];
+                w[j] += (float)(options.rate * grad[j] / hits[j]);
+                grad[j] = 0;
+                hits[j] = 0;
+            }
+            touched.clear();
+            for (int k = 0; k < 2; k++) {
+                if (scalar_norm[k] > 0) w[mobility_at + k] += (float)(options.rate * scalar_grad[k] / scalar_norm[k]);
+            }
+        }
+        return squared;
+    }
+
+    void parallel_for(size_t count, const std::function<void(size_t, int)>& body) {
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < options.threads; t++) {
+            threads.push_back(std::thread([&next, count, &body, t]() {
+                while (true) {
+                    size_t i = next.fetch_add(1);
+                    if (i >= count) return;
+                    body(i, t);
+                }
+            }));
+        }
+        for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+    }
+
+    double validation_error() {
+        const size_t chunk = 4096;
+        size_t chunks = (validation.size() + chunk - 1) / chunk;
+        std::vector<double> partial(chunks, 0);
+        parallel_for(chunks, [this, &partial, chunk](size_t c, int) {
+            size_t end = std::min(validation.size(), (c + 1) * chunk);
+            for (size_t k = c * chunk; k < end; k++) {
+                const Sample& s = samples[validation[k]];
+                float residual = s.target - predict(s);
+                partial[c] += (double)residual * residual;
+            }
+        });
+        double sum = 0;
+        for (size_t c = 0; c < chunks; c++) sum += partial[c];
+        return sum;
+    }
+
+public:
+    Trainer(const Evaluator& e, const TrainOptions& o) : evaluator(e), options(o) {
+        phase_size = evaluator.get_phase_size();
+        mobility_at = phase_size - Evaluator::SCALAR_WEIGHTS;
+        for (int i = 0; i < Evaluator::INSTANCES; i++) {
+            offset_of.push_back(evaluator.get_kind_offset(evaluator.get_kind(i)));
+        }
+        // 從目前的權重出發，資料裡沒出現過的樣式保留原值
+        const int16_t* start = evaluator.get_weights();
+        weights.assign(start, start + evaluator.weight_count());
+        train_by_phase.resize(Evaluator::PHASES);
+    }
+
+    // 同一局的局面相鄰，以 256 筆為一塊切出驗證資料，避免同一局同時出現在兩邊太多
+    void load(const TrainingFile& file) {
+        samples.resize(file.size());
+        const size_t chunk = 65536;
+        parallel_for((file.size() + chunk - 1) / chunk, [this, &file, chunk](size_t c, int) {
+            size_t end = std::min(file.size(), (c + 1) * chunk);
+            for (size_t i = c * chunk; i < end; i++) {
+                TrainingRecord r;
+                file.get(i, r);
+                Evaluator::State st;
+                evaluator.init_state(st, r.black, r.white);
+                Sample& s = samples[i];
+                memcpy(s.idx, st.idx, sizeof(s.idx));
+                s.phase = (uint8_t)Evaluator::phase_of(r.black, r.white);
+                s.mobility = (int8_t)(Bitboard::popcount(Bitboard::get_moves(r.black, r.white)) -
+                                      Bitboard::popcount(Bitboard::get_moves(r.white, r.black)));
+                s.potential = (int8_t)(Bitboard::popcount(Bitboard::get_frontier_empties(r.white, r.black)) -
+                                       Bitboard::popcount(Bitboard::get_frontier_empties(r.black, r.white)));
+                s.target = (float)(r.diff * DISC);
+            }
+        });
+        for (size_t i = 0; i < samples.size(); i++) {
+            if (options.holdout > 0 && (i / 256) % options.holdout == 0) {
+                validation.push_back((uint32_t)i);
+            } else {
+                train_by_phase[samples[i].phase].push_back((uint32_t)i);
+            }
+        }
+    }
+
+    size_t train_count() const { return samples.size() - validation.size(); }
+    size_t validation_count() const { return validation.size(); }
+
+    void train() {
+        // 每條執行緒自己的梯度累加區（只有一個階段那麼大）
+        std::vector<std::vector<float> > grads(options.threads, std::vector<float>(phase_size, 0));
+        std::vector<std::vector<uint32_t> > hits(options.threads, std::vector<uint32_t>(phase_size, 0));
+        std::vector<std::vector<int> > touched(options.threads);
+
+        // 資料不多時很快就過擬合，保留驗證誤差最小的那一輪
+        double best_error = 0;
+        int best_epoch = 0;
+        std::vector<float> best_weights;
+        if (!validation.empty()) {
+            best_error = std::sqrt(validation_error() / validation.size()) / DISC;
+            best_weights = weights;
+            std::cout << "epoch   0  validation " << std::fixed << std::setprecision(2) << best_error << " discs\n";
+        }
+        for (int epoch = 1; epoch <= options.epochs; epoch++) {
+            Clock::time_point begin = Clock::now();
+            std::vector<double> squared(Evaluator::PHASES, 0);
+            parallel_for(Evaluator::PHASES, [this, epoch, &squared, &grads, &hits, &touched](size_t phase, int t) {
+                squared[phase] = train_phase((int)phase, epoch, grads[t], hits[t], touched[t]);
+            });
+            double total = 0;
+            for (int p = 0; p < Evaluator::PHASES; p++) total += squared[p];
+            double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+            std::cout << "epoch " << std::setw(3) << epoch << std::fixed << std::setprecision(2)
+                      << "  train " << std::sqrt(total / train_count()) / DISC << " discs";
+            if (!validation.empty()) {
+                double error = std::sqrt(validation_error() / validation.size()) / DISC;
+                std::cout << "  validation " << error << " discs";
+                if (error < best_error) {
+                    best_error = error;
+                    best_epoch = epoch;
+                    best_weights = weights;
+                }
+            }
+            std::cout << std::setprecision(0) << "  " << train_count() / seconds << " positions/s\n";
+        }
+        if (!validation.empty() && best_epoch != options.epochs) {
+            weights.swap(best_weights);
+            std::cout << "Keeping epoch " << best_epoch << std::setprecision(2)
+                      << " (validation " << best_error << " discs)\n";
+        }
+    }
+
+    std::vector<int16_t> rounded() const {
+        std::vector<int16_t> out(weights.size());
+        for (size_t i = 0; i < weights.size(); i++) {
+            float w = std::floor(weights[i] + 0.5f);
+            if (w > 32767) w = 32767;
+            if (w < -32768) w = -32768;
+            out[i] = (int16_t)w;
+        }
+        return out;
+    }
+};
+
+static void usage(const char* prog) {
+    std::cout << "Usage: " << prog << " <selfplay.bin> <weights.bin> [options]\n"
+              << "  --epochs <n>    passes over the data (default 20)\n"
+              << "  --threads <n>   worker threads, one game phase at a time (default: all cores)\n"
+              << "  --batch <n>     positions per minibatch (default 256)\n"
+              << "  --rate <r>      learning rate (default 0.01)\n"
+              << "  --holdout <n>   keep every n-th block of positions for validation (default 20, 0 = none);\n"
+              << "                  the epoch with the lowest validation error is written\n"
+              << "  --init <file>   start from these weights instead of the built-in defaults\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    std::string data_path = argv[1], out_path = argv[2], init_path;
+    TrainOptions options;
+    options.epochs = 20;
+    options.threads = (int)std::thread::hardware_concurrency();
+    options.batch = 256;
+    options.rate = 0.01;
+    options.holdout = 20;
+
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--epochs" && i + 1 < argc) {
+            options.epochs = atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            options.batch = atoi(argv[++i]);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            options.rate = atof(argv[++i]);
+        } else if (arg == "--holdout" && i + 1 < argc) {
+            options.holdout = atoi(argv[++i]);
+        } else if (arg == "--init" && i + 1 < argc) {
+            init_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.threads < 1) options.threads = 1;
+    if (options.epochs < 0 || options.batch < 1 || options.rate <= 0 || options.holdout < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Evaluator& evaluator = Evaluator::instance();
+    WeightFile init;
+    if (!init_path.empty()) {
+        if (!init.open(init_path, evaluator)) {
+            std::cerr << "Cannot load weights " << init_path << "\n";
+            return 1;
+        }
+        evaluator.set_weights(init.weights());
+    }
+
+    TrainingFile data;
+    if (!data.open(data_path)) {
+        std::cerr << "Cannot open self-play data " << data_path << "\n";
+        return 1;
+    }
+
+    Trainer trainer(evaluator, options);
+    trainer.load(data);
+    std::cout << data.size() << " positions (" << trainer.train_count() << " training, "
+              << trainer.validation_count() << " validation), " << evaluator.weight_count() << " weights, "
+              << options.threads << " thread" << (options.threads > 1 ? "s" : "") << "\n";
+    trainer.train();
+
+    std::vector<int16_t> result = trainer.rounded();
+    if (!WeightFile::save(out_path, evaluator, &result[0])) {
+        std::cerr << "Cannot write " << out_path << "\n";
+        return 1;
+    }
+    std::cout << "Weights written to " << out_path << "\n";
+    return 0;
+}
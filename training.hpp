@@ -0,0 +1,108 @@
+#ifndef TRAINING_HPP
+#define TRAINING_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// 自我對局資料檔（little-endian）：
+//
+//   "RVSELF01"
+//   record*    每筆 18 bytes：[X 的棋子 u64][O 的棋子 u64][輪到誰 u8：0 X、1 O][X 減 O 的終局差 i8]
+//
+// 終局差把空格算給勝方（與 Engine 的終局分數相同）。
+// 記錄逐局附加，同一局的局面相鄰；讀取端 mmap 後依序解碼。
+struct TrainingRecord {
+    uint64_t black;
+    uint64_t white;
+    char player;
+    int diff;
+};
+
+class TrainingFile {
+public:
+    static const size_t RECORD_SIZE = 18;
+
+private:
+    int fd;
+    void* mapping;
+    size_t mapped_size;
+    const unsigned char* records;
+    size_t count;
+
+    TrainingFile(const TrainingFile&);
+    TrainingFile& operator=(const TrainingFile&);
+
+public:
+    static const char* magic() { return "RVSELF01"; }
+
+    TrainingFile() : fd(-1), mapping(NULL), mapped_size(0), records(NULL), count(0) {}
+
+    ~TrainingFile() {
+        close();
+    }
+
+    static void encode(const TrainingRecord& r, std::string& out) {
+        for (int i = 0; i < 8; i++) out += (char)((r.black >> (8 * i)) & 0xFF);
+        for (int i = 0; i < 8; i++) out += (char)((r.white >> (8 * i)) & 0xFF);
+        out += (char)(r.player == 'X' ? 0 : 1);
+        out += (char)(int8_t)r.diff;
+    }
+
+    // 尾端不完整的記錄（例如產生中途被中斷）不算
+    bool open(const std::string& path) {
+        close();
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < 8) {
+            close();
+            return false;
+        }
+        mapped_size = (size_t)st.st_size;
+        mapping = mmap(NULL, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = NULL;
+            close();
+            return false;
+        }
+        if (memcmp(mapping, magic(), 8) != 0) {
+            close();
+            return false;
+        }
+        // 訓練時從頭讀到尾
+        madvise(mapping, mapped_size, MADV_SEQUENTIAL);
+        records = static_cast<const unsigned char*>(mapping) + 8;
+        count = (mapped_size - 8) / RECORD_SIZE;
+        return true;
+    }
+
+    void close() {
+        if (mapping) munmap(mapping, mapped_size);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        mapping = NULL;
+        mapped_size = 0;
+        records = NULL;
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+
+    void get(size_t i, TrainingRecord& r) const {
+        const unsigned char* p = records + i * RECORD_SIZE;
+        r.black = 0;
+        r.white = 0;
+        for (int b = 0; b < 8; b++) r.black |= (uint64_t)p[b] << (8 * b);
+        for (int b = 0; b < 8; b++) r.white |= (uint64_t)p[8 + b] << (8 * b);
+        r.player = p[16] ? 'O' : 'X';
+        r.diff = (int8_t)p[17];
+    }
+};
+
+#endif // TRAINING_HPP
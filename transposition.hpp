@@ -0,0 +1,270 @@
+#ifndef TRANSPOSITION_HPP
+#define TRANSPOSITION_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// 置換表查到的資料
+struct TTData {
+    int move;       // 0..63，沒有最佳步時為 -1
+    int depth;
+    int score;
+    int bound;      // TranspositionTable::EXACT / LOWER / UPPER
+};
+
+// 計數器合計結果
+struct TTStats {
+    uint64_t probes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t overwrites;   // 覆蓋掉另一個局面的資料
+    uint64_t collisions;   // 雜湊相同但內容對不上（例如最佳步不合法）
+
+    double hit_rate() const {
+        return probes ? (double)hits / probes : 0.0;
+    }
+};
+
+// 固定大小、無鎖、多執行緒共用的置換表
+//
+// 每個 bucket 剛好一條 cache line（4 個 entry），entry 存 key ^ data 與 data，
+// 讀寫都是兩個 relaxed 的 64 位元操作；若另一執行緒寫到一半，key ^ data
+// 對不上就當作沒查到，不需要 mutex。
+class TranspositionTable {
+public:
+    enum Bound { NONE = 0, UPPER = 1, LOWER = 2, EXACT = 3 };
+
+    static const int MAX_SHARDS = 64;
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check;   // key ^ data
+        std::atomic<uint64_t> data;
+    };
+
+    static const int BUCKET_SIZE = 4;
+
+    struct alignas(64) Bucket {
+        Entry entries[BUCKET_SIZE];
+    };
+
+    // 每個執行緒各自一組計數器，避免所有搜尋執行緒搶同一條 cache line
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> probes;
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> stores;
+        std::atomic<uint64_t> overwrites;
+        std::atomic<uint64_t> collisions;
+    };
+
+    Bucket* buckets;
+    uint64_t bucket_mask;
+    uint8_t generation;
+    Shard* shards;
+
+    // data 的 bit 配置：
+    //   0..6   move + 1（0 代表沒有）
+    //   7..13  depth
+    //   14..15 bound
+    //   16..23 generation
+    //   32..63 score
+    static uint64_t pack(int move, int depth, int score, int bound, uint8_t gen) {
+        return (uint64_t)(move + 1)
+             | ((uint64_t)depth << 7)
+             | ((uint64_t)bound << 14)
+             | ((uint64_t)gen << 16)
+             | ((uint64_t)(uint32_t)score << 32);
+    }
+
+    static int data_depth(uint64_t d) { return (int)(d >> 7 & 0x7F); }
+    static uint8_t data_generation(uint64_t d) { return (uint8_t)(d >> 16); }
+
+    static void unpack(uint64_t d, TTData& out) {
+        out.move = (int)(d & 0x7F) - 1;
+        out.depth = data_depth(d);
+        out.bound = (int)(d >> 14 & 3);
+        out.score = (int32_t)(uint32_t)(d >> 32);
+    }
+
+    Shard& shard(int id) {
+        return shards[id & (MAX_SHARDS - 1)];
+    }
+
+    static void* aligned_alloc64(size_t bytes) {
+        void* mem = NULL;
+        if (posix_memalign(&mem, 64, bytes) != 0) {
+            throw std::bad_alloc();
+        }
+        return mem;
+    }
+
+    void release() {
+        if (buckets) {
+            free(buckets);
+            buckets = NULL;
+        }
+    }
+
+    TranspositionTable(const TranspositionTable&);
+    TranspositionTable& operator=(const TranspositionTable&);
+
+public:
+    explicit TranspositionTable(size_t megabytes = 16) {
+        buckets = NULL;
+        bucket_mask = 0;
+        generation = 0;
+        shards = static_cast<Shard*>(aligned_alloc64(MAX_SHARDS * sizeof(Shard)));
+        resize(megabytes);
+    }
+
+    ~TranspositionTable() {
+        release();
+        free(shards);
+    }
+
+    // 以 MB 指定大小，實際 bucket 數取不超過的 2 的次方
+    void resize(size_t megabytes) {
+        release();
+
+        size_t count = 1;
+        while (count * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024) {
+            count *= 2;
+        }
+
+        buckets = static_cast<Bucket*>(aligned_alloc64(count * sizeof(Bucket)));
+        bucket_mask = count - 1;
+        clear();
+    }
+
+    void clear() {
+        memset(static_cast<void*>(buckets), 0, (bucket_mask + 1) * sizeof(Bucket));
+        memset(static_cast<void*>(shards), 0, MAX_SHARDS * sizeof(Shard));
+        generation = 0;
+    }
+
+    // 每次新的搜尋開始時呼叫，讓舊搜尋留下的 entry 優先被替換
+    void new_search() {
+        generation++;
+    }
+
+    bool probe(uint64_t key, TTData& out, int thread_id = 0) {
+        Shard& s = shard(thread_id);
+        s.probes.fetch_add(1, std::memory_order_relaxed);
+
+        Bucket& b = buckets[key & bucket_mask];
+        for (int i = 0; i < BUCKET_SIZE; i++) {
+            uint64_t d = b.entries[i].data.load(std::memory_order_relaxed);
+            uint64_t c = b.entries[i].check.load(std::memory_order_relaxed);
+            if (d != 0 && (c ^ d) == key) {
+                unpack(d, out);
+                s.hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 深度優先的替換策略：同一局面直接更新；否則挑空格，
+    // 再否則挑「深度 - 年齡」最小的 entry
+    void store(uint64_t key, int move, int depth, int score, int bound, int thread_id = 0) {
+        Shard& s = shard(thread_id);
+        s.stores.fetch_add(1, std::memory_order_relaxed);
+
+        if (depth > 127) depth = 127;
+        if (depth < 0) depth = 0;
+
+        Bucket& b = buckets[key & bucket_mask];
+        Entry* victim = NULL;
+        Entry* empty = NULL;
+        int victim_value = 1 << 30;
+        bool same_key = false;
+
+        for (int i = 0; i < BUCKET_SIZE; i++) {
+            Entry& e = b.entries[i];
+            uint64_t d = e.data.load(std::memory_order_relaxed);
+            uint64_t c = e.check.load(std::memory_order_relaxed);
+
+            if (d == 0) {
+                if (!empty) empty = &e;
+                continue;
+            }
+            if ((c ^ d) == key) {
+                // 較淺的非 EXACT 結果不蓋掉較深的資料，但保留最佳步
+                if (depth < data_depth(d) && bound != EXACT) {
+                    if (move < 0) return;
+                    TTData old;
+                    unpack(d, old);
+                    uint64_t nd = pack(move, old.depth, old.score, old.bound, generation);
+                    e.data.store(nd, std::memory_order_relaxed);
+                    e.check.store(key ^ nd, std::memory_order_relaxed);
+                    return;
+                }
+                victim = &e;
+                same_key = true;
+                break;
+            }
+
+            int age = (uint8_t)(generation - data_generation(d));
+            int value = data_depth(d) - 8 * age;
+            if (value < victim_value) {
+                victim = &e;
+                victim_value = value;
+            }
+        }
+
+        // 空格一定優先（過期 entry 的「深度 - 年齡」可能比空格還小，但仍是有用的資料）；
+        // 蓋掉別的局面才算一次 overwrite
+        if (!same_key) {
+            if (empty) {
+                victim = empty;
+            } else {
+                s.overwrites.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        uint64_t nd = pack(move, depth, score, bound, generation);
+        victim->data.store(nd, std::memory_order_relaxed);
+        victim->check.store(key ^ nd, std::memory_order_relaxed);
+    }
+
+    // 搜尋發現查到的資料和局面不符時回報
+    void record_collision(int thread_id = 0) {
+        shard(thread_id).collisions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    TTStats get_stats() const {
+        TTStats st;
+        memset(&st, 0, sizeof(st));
+        for (int i = 0; i < MAX_SHARDS; i++) {
+            st.probes += shards[i].probes.load(std::memory_order_relaxed);
+            st.hits += shards[i].hits.load(std::memory_order_relaxed);
+            st.stores += shards[i].stores.load(std::memory_order_relaxed);
+            st.overwrites += shards[i].overwrites.load(std::memory_order_relaxed);
+            st.collisions += shards[i].collisions.load(std::memory_order_relaxed);
+        }
+        st.misses = st.probes - st.hits;
+        return st;
+    }
+
+    size_t size_bytes() const {
+        return (bucket_mask + 1) * sizeof(Bucket);
+    }
+
+    // 已使用的 entry 比例（抽樣前 1000 個 bucket）
+    double usage() const {
+        uint64_t n = bucket_mask + 1 < 1000 ? bucket_mask + 1 : 1000;
+        uint64_t used = 0;
+        for (uint64_t i = 0; i < n; i++) {
+            for (int j = 0; j < BUCKET_SIZE; j++) {
+                if (buckets[i].entries[j].data.load(std::memory_order_relaxed) != 0) used++;
+            }
+        }
+        return (double)used / (n * BUCKET_SIZE);
+    }
+};
+
+#endif // TRANSPOSITION_HPP
@@ -0,0 +1,72 @@
+#ifndef ZOBRIST_HPP
+#define ZOBRIST_HPP
+
+#include <cstdint>
+
+// Zobrist 雜湊亂數表：每格黑/白各一個 key，另有輪到白方時的 side key
+class Zobrist {
+private:
+    uint64_t piece[2][64];
+    uint64_t flip[64];      // piece[0][sq] ^ piece[1][sq]，翻子時用
+    uint64_t side;
+
+    // splitmix64，固定種子讓每次執行的雜湊值一致（開局庫、存檔可重現）
+    static uint64_t next(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    Zobrist() {
+        uint64_t state = 0x5EED0DE11E5ULL;
+        for (int c = 0; c < 2; c++) {
+            for (int sq = 0; sq < 64; sq++) {
+                piece[c][sq] = next(state);
+            }
+        }
+        for (int sq = 0; sq < 64; sq++) {
+            flip[sq] = piece[0][sq] ^ piece[1][sq];
+        }
+        side = next(state);
+    }
+
+    static const Zobrist& instance() {
+        static const Zobrist table;
+        return table;
+    }
+
+public:
+    // color: 0 = X（黑），1 = O（白）
+    static uint64_t piece_key(int color, int sq) { return instance().piece[color][sq]; }
+    static uint64_t flip_key(int sq) { return instance().flip[sq]; }
+    static uint64_t side_key() { return instance().side; }
+
+    // 對一組翻轉棋子做增量更新
+    static uint64_t flips_key(uint64_t flips) {
+        const Zobrist& z = instance();
+        uint64_t h = 0;
+        while (flips) {
+            h ^= z.flip[__builtin_ctzll(flips)];
+            flips &= flips - 1;
+        }
+        return h;
+    }
+
+    // 從頭計算整個盤面的雜湊（不含輪到誰）
+    static uint64_t hash_board(uint64_t black, uint64_t white) {
+        const Zobrist& z = instance();
+        uint64_t h = 0;
+        while (black) {
+            h ^= z.piece[0][__builtin_ctzll(black)];
+            black &= black - 1;
+        }
+        while (white) {
+            h ^= z.piece[1][__builtin_ctzll(white)];
+            white &= white - 1;
+        }
+        return h;
+    }
+};
+
+#endif // ZOBRIST_HPP